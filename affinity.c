@@ -0,0 +1,317 @@
+/**
+ * @file affinity.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the CPU pinning policies manage and compute use to keep computes
+ * and their threads on one CPU and their memory on that CPU's NUMA node.
+ *
+ */
+#define _GNU_SOURCE // For sched_setaffinity() and CPU_SET()
+#include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h> // For CHAR_BIT
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "affinity.h"
+
+/// Largest length of a sysfs CPU directory path
+#define AFFINITY_PATH 64
+
+/// Memory policy preferring one node, from linux/mempolicy.h
+#define MPOL_PREFERRED 1
+
+/// Number of words in a node mask
+#define NODE_WORDS (AFFINITY_NODES / (sizeof(unsigned long) * CHAR_BIT))
+
+/**
+ * CPU with the node it belongs to, for sorting
+ */
+struct cpu_node {
+	int cpu;
+	int node;
+};
+
+/**
+ * @brief Orders CPUs by node, then by number
+ *
+ * Preconditions: a and b are not NULL
+ *
+ * Postconditions:
+ *
+ * @param a First struct cpu_node
+ * @param b Second struct cpu_node
+ * @return Negative, zero or positive as a sorts before, with or after b
+ */
+static int cpu_node_compare(const void *a, const void *b);
+
+/**
+ * @brief Orders the CPUs in this process's affinity mask for a policy
+ *
+ * Preconditions: affinity is not NULL, its policy is AFFINITY_COMPACT or
+ * AFFINITY_SCATTER
+ *
+ * Postconditions: affinity holds the CPU order on success
+ *
+ * @param affinity Policy to order the CPUs for
+ * @return true on success, false otherwise
+ */
+static bool affinity_order(struct affinity *affinity);
+
+/**
+ * @brief Parses a comma separated list of CPUs and CPU ranges
+ *
+ * Preconditions: arg is not NULL, affinity is not NULL
+ *
+ * Postconditions: affinity holds the CPUs in the order listed on success
+ *
+ * @param arg CPU list
+ * @param affinity Pointer to load the CPUs into
+ * @return true on success, false if arg is not a valid list
+ */
+static bool affinity_list(const char *arg, struct affinity *affinity);
+
+bool affinity_parse(const char *arg, struct affinity *affinity) {
+	assert(arg != NULL);
+	assert(affinity != NULL);
+
+	affinity->ncpus = 0;
+
+	if (strcmp(arg, "compact") == 0) {
+		affinity->policy = AFFINITY_COMPACT;
+		return affinity_order(affinity);
+	} else if (strcmp(arg, "scatter") == 0) {
+		affinity->policy = AFFINITY_SCATTER;
+		return affinity_order(affinity);
+	}
+
+	affinity->policy = AFFINITY_LIST;
+	return affinity_list(arg, affinity);
+}
+
+unsigned int affinity_cpus(void) {
+	cpu_set_t set;
+	int count;
+
+	if (sched_getaffinity(0, sizeof(set), &set) == -1) {
+		perror("Could not get CPU affinity");
+		return 1;
+	}
+
+	count = CPU_COUNT(&set);
+	return (count > 0) ? (unsigned int)count : 1;
+}
+
+int affinity_cpu(const struct affinity *affinity, unsigned int slot) {
+	assert(affinity != NULL);
+
+	if ((affinity->policy == AFFINITY_NONE) || (affinity->ncpus == 0)) {
+		return -1;
+	}
+
+	return affinity->cpus[slot % affinity->ncpus];
+}
+
+int affinity_node(int cpu) {
+	char path[AFFINITY_PATH];
+	struct dirent *entry;
+	DIR *dir;
+	int node = 0;
+
+	// sysfs links each CPU to its node as a nodeN entry in the CPU's directory
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	dir = opendir(path);
+	if (dir == NULL) {
+		return 0;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		if ((strncmp(entry->d_name, "node", 4) == 0) &&
+				(isdigit((unsigned char)entry->d_name[4]) != 0)) {
+			node = atoi(entry->d_name + 4);
+			break;
+		}
+	}
+
+	closedir(dir);
+	return node;
+}
+
+bool affinity_pin(int cpu) {
+	cpu_set_t set;
+
+	assert(cpu >= 0);
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	// Linux takes pid 0 to mean the calling thread, not the whole process
+	if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+		fprintf(stderr, "Could not pin to CPU %d: %s\n", cpu, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool affinity_bind(int node) {
+	unsigned long mask[NODE_WORDS];
+	unsigned int bits = sizeof(unsigned long) * CHAR_BIT;
+
+	assert(node >= 0);
+	assert(node < AFFINITY_NODES);
+
+	memset(mask, 0, sizeof(mask));
+	mask[node / bits] |= 1UL << (node % bits);
+
+	// glibc has no wrapper and libnuma is not worth a dependency for one call
+	if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, AFFINITY_NODES) == -1) {
+		if (errno == ENOSYS) {
+			return true;
+		}
+		fprintf(stderr, "Could not bind memory to node %d: %s\n", node, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+static int cpu_node_compare(const void *a, const void *b) {
+	const struct cpu_node *x = a;
+	const struct cpu_node *y = b;
+
+	assert(a != NULL);
+	assert(b != NULL);
+
+	if (x->node != y->node) {
+		return (x->node < y->node) ? -1 : 1;
+	}
+
+	return (x->cpu < y->cpu) ? -1 : (x->cpu > y->cpu);
+}
+
+static bool affinity_order(struct affinity *affinity) {
+	struct cpu_node found[AFFINITY_CPUS];
+	unsigned int next[AFFINITY_CPUS];
+	unsigned int stop[AFFINITY_CPUS];
+	unsigned int nfound = 0;
+	unsigned int ngroups = 0;
+	unsigned int i;
+	cpu_set_t set;
+	int cpu;
+
+	assert(affinity != NULL);
+
+	if (sched_getaffinity(0, sizeof(set), &set) == -1) {
+		perror("Could not get CPU affinity");
+		return false;
+	}
+
+	for (cpu = 0; cpu < AFFINITY_CPUS; cpu++) {
+		if (CPU_ISSET(cpu, &set)) {
+			found[nfound].cpu = cpu;
+			found[nfound].node = affinity_node(cpu);
+			nfound++;
+		}
+	}
+
+	// Compact is this order as it is: node by node, and within a node by
+	// number, which on Linux puts a core's hyperthread siblings last
+	qsort(found, nfound, sizeof(found[0]), cpu_node_compare);
+
+	if (affinity->policy == AFFINITY_COMPACT) {
+		for (i = 0; i < nfound; i++) {
+			affinity->cpus[i] = found[i].cpu;
+		}
+		affinity->ncpus = nfound;
+		return true;
+	}
+
+	// Scatter deals one CPU from each node's run in turn
+	for (i = 0; i < nfound; i++) {
+		if ((i == 0) || (found[i].node != found[i - 1].node)) {
+			next[ngroups++] = i;
+		}
+		stop[ngroups - 1] = i + 1;
+	}
+
+	while (affinity->ncpus < nfound) {
+		for (i = 0; i < ngroups; i++) {
+			if (next[i] < stop[i]) {
+				affinity->cpus[affinity->ncpus++] = found[next[i]++].cpu;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool affinity_list(const char *arg, struct affinity *affinity) {
+	const char *s = arg;
+	char *end;
+	long first;
+	long last;
+	long cpu;
+
+	assert(arg != NULL);
+	assert(affinity != NULL);
+
+	while (*s != '\0') {
+		if (isdigit((unsigned char)*s) == 0) {
+			return false;
+		}
+		first = strtol(s, &end, 10);
+		last = first;
+		if (*end == '-') {
+			s = end + 1;
+			if (isdigit((unsigned char)*s) == 0) {
+				return false;
+			}
+			last = strtol(s, &end, 10);
+		}
+
+		if ((last < first) || (last >= AFFINITY_CPUS)) {
+			return false;
+		}
+
+		for (cpu = first; (cpu <= last) && (affinity->ncpus < AFFINITY_CPUS); cpu++) {
+			affinity->cpus[affinity->ncpus++] = (int)cpu;
+		}
+
+		if (*end == ',') {
+			end++;
+		} else if (*end != '\0') {
+			return false;
+		}
+		s = end;
+	}
+
+	return (affinity->ncpus > 0);
+}
@@ -0,0 +1,143 @@
+/**
+ * @file affinity.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the CPU pinning policies manage and compute use to keep computes
+ * and their threads on one CPU and their memory on that CPU's NUMA node.
+ *
+ */
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdbool.h>
+
+/// Highest number of CPUs a policy can order, the size of a cpu_set_t
+#define AFFINITY_CPUS 1024
+
+/// Highest number of NUMA nodes memory can be bound to
+#define AFFINITY_NODES 1024
+
+/**
+ * How threads are spread over the CPUs
+ */
+enum affinity_policy {
+	AFFINITY_NONE,		///< Threads float wherever the scheduler puts them
+	AFFINITY_COMPACT,	///< Fill one NUMA node's CPUs before the next node's
+	AFFINITY_SCATTER,	///< Take one CPU from each node in turn
+	AFFINITY_LIST		///< Take CPUs in the order they were listed
+};
+
+/**
+ * Pinning policy and the order it hands out CPUs in
+ */
+struct affinity {
+	enum affinity_policy policy;	///< How the order was built
+	unsigned int ncpus;				///< Number of CPUs in the order
+	int cpus[AFFINITY_CPUS];		///< CPU for each slot, repeating after ncpus
+};
+
+/**
+ * @brief Parses a pinning policy
+ *
+ * arg is compact, scatter, or a comma separated list of CPUs and CPU ranges
+ * such as 0-3,8. compact and scatter order the CPUs in this process's
+ * affinity mask, grouped by the NUMA node sysfs puts them on.
+ *
+ * Preconditions: arg is not NULL, affinity is not NULL
+ *
+ * Postconditions: affinity holds the policy and its CPU order on success
+ *
+ * @param arg Policy name or CPU list
+ * @param affinity Pointer to load the policy into
+ * @return true on success, false if arg is not a policy or lists no CPUs
+ */
+bool affinity_parse(const char *arg, struct affinity *affinity);
+
+/**
+ * @brief Counts the CPUs this process may run on
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return Number of CPUs in the affinity mask, 1 if it cannot be read
+ */
+unsigned int affinity_cpus(void);
+
+/**
+ * @brief Picks the CPU for a thread or process
+ *
+ * Preconditions: affinity is not NULL
+ *
+ * Postconditions:
+ *
+ * @param affinity Policy to follow
+ * @param slot Position of the thread or process among its peers
+ * @return The CPU, or -1 if the policy is AFFINITY_NONE
+ */
+int affinity_cpu(const struct affinity *affinity, unsigned int slot);
+
+/**
+ * @brief Finds the NUMA node a CPU belongs to
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param cpu CPU to look up
+ * @return The node, 0 if sysfs does not say
+ */
+int affinity_node(int cpu);
+
+/**
+ * @brief Pins the calling thread to one CPU
+ *
+ * Preconditions: cpu is not negative
+ *
+ * Postconditions: The thread only runs on cpu on success
+ *
+ * @param cpu CPU to run on
+ * @return true on success, false otherwise
+ */
+bool affinity_pin(int cpu);
+
+/**
+ * @brief Has the calling thread allocate its memory on one NUMA node
+ *
+ * The node is preferred rather than required, so allocations fall back to
+ * other nodes instead of failing once it is full. Kernels built without NUMA
+ * support have nothing to bind, which counts as success.
+ *
+ * Preconditions: node is not negative and less than AFFINITY_NODES
+ *
+ * Postconditions: Pages the thread touches first come from node when it has
+ * room
+ *
+ * @param node Node to allocate from
+ * @return true on success, false otherwise
+ */
+bool affinity_bind(int node);
+
+#endif // AFFINITY_H
@@ -0,0 +1,264 @@
+/**
+ * @file aliquot.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Defines the aliquot sequence engine and the sigma cache that compute
+ * processes share while running sequences.
+ *
+ */
+#include <sys/mman.h>
+#include <sys/stat.h> // For S_IRUSR, etc.
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "aliquot.h"
+#include "factor.h"
+
+/**
+ * @brief Takes one step, stopping at the terminating 1
+ *
+ * Preconditions: res has been attached, n is positive, s is not NULL
+ *
+ * Postconditions: s holds the next term, 0 after 1
+ *
+ * @param res Pointer to cache resource structure
+ * @param n Current term
+ * @param s Pointer to load the next term into
+ * @param record Record whose counters to bump, may be NULL
+ * @return false if the next term does not fit in 64 bits, true otherwise
+ */
+static bool step(struct aliquot_res *res, uint64_t n, uint64_t *s,
+		struct aliquot_record *record);
+
+size_t aliquot_size(uint64_t slots) {
+	return sizeof(uint64_t) + (slots * sizeof(struct aliquot_entry));
+}
+
+void aliquot_map(struct aliquot_res *res, void *addr, uint64_t slots) {
+	assert(res != NULL);
+	assert(addr != NULL);
+
+	res->addr = addr;
+	res->slots = res->addr;
+	res->entries = (struct aliquot_entry *)(res->slots + 1);
+	res->end = res->entries + slots;
+}
+
+bool aliquot_attach(struct aliquot_res *res) {
+	size_t total_size;
+	int fd;
+	void *addr;
+
+	assert(res != NULL);
+
+	fd = shm_open(ALIQUOT_PATH, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd == -1) {
+		perror("Could not open sigma cache");
+		return false;
+	}
+
+	// Growing an object to the size it already has leaves it untouched, and
+	// a new one reads as zeros, which is an empty cache
+	total_size = aliquot_size(ALIQUOT_SLOTS);
+	if (ftruncate(fd, total_size) == -1) {
+		perror("Could not resize sigma cache");
+		close(fd);
+		return false;
+	}
+
+	addr = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		perror("Could not map sigma cache");
+		return false;
+	}
+
+	aliquot_map(res, addr, ALIQUOT_SLOTS);
+	*res->slots = ALIQUOT_SLOTS;
+
+	return true;
+}
+
+void aliquot_detach(struct aliquot_res *res) {
+	assert(res != NULL);
+
+	munmap(res->addr, (char *)res->end - (char *)res->addr);
+	res->addr = NULL;
+}
+
+bool aliquot_next(struct aliquot_res *res, uint64_t n, uint64_t *s,
+		struct aliquot_record *record) {
+	struct aliquot_entry *entry;
+	unsigned __int128 sigma;
+	uint64_t mask = *res->slots - 1;
+	uint64_t home;
+	uint64_t expected;
+	uint64_t value;
+	unsigned int i;
+
+	assert(n >= 2);
+	assert(s != NULL);
+
+	// Fibonacci hashing spreads nearby terms across the table
+	home = (n * 0x9e3779b97f4a7c15ULL) >> (64 - ALIQUOT_BITS);
+
+	for (i = 0; i < ALIQUOT_PROBES; i++) {
+		entry = &res->entries[(home + i) & mask];
+		expected = __atomic_load_n(&entry->n, __ATOMIC_ACQUIRE);
+		if (expected == n) {
+			value = __atomic_load_n(&entry->s, __ATOMIC_ACQUIRE);
+			if (value != 0) {
+				if (record != NULL) {
+					record->cached++;
+				}
+				*s = value;
+				return true;
+			}
+
+			// Another process is still factoring n, so do it here too
+			// rather than wait
+			break;
+		} else if (expected == 0) {
+			break;
+		}
+	}
+
+	if (record != NULL) {
+		record->computed++;
+	}
+
+	sigma = factor_sigma(n) - n;
+	if (sigma > UINT64_MAX) {
+		return false;
+	}
+	*s = sigma;
+
+	// Publish the sum in the first slot that is free or already has n
+	for (i = 0; i < ALIQUOT_PROBES; i++) {
+		entry = &res->entries[(home + i) & mask];
+		expected = 0;
+		if (__atomic_compare_exchange_n(&entry->n, &expected, n, false,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == true) {
+			__atomic_store_n(&entry->s, *s, __ATOMIC_RELEASE);
+			break;
+		} else if (expected == n) {
+			// Whoever claimed it stores the same sum
+			break;
+		}
+	}
+
+	// Else the probe run is full and n is simply not cached
+	return true;
+}
+
+void aliquot_run(struct aliquot_res *res, uint64_t start, uint64_t max_steps,
+		struct aliquot_record *record) {
+	uint64_t power = 1;
+	uint64_t lambda = 1;
+	uint64_t tortoise = start;
+	uint64_t hare = start;
+	uint64_t taken = 0;
+	uint64_t i;
+
+	assert(start > 0);
+	assert(record != NULL);
+
+	record->start = start;
+	record->steps = 0;
+	record->cycle = 0;
+	record->peak = start;
+	record->cached = 0;
+	record->computed = 0;
+
+	// Brent's algorithm: the tortoise jumps to the hare at each power of two,
+	// and lambda counts the hare's steps since then
+	while (1) {
+		if (hare == 1) {
+			record->steps = taken;
+			record->end = ALIQUOT_TERMINATES;
+			return;
+		}
+
+		if (taken == max_steps) {
+			record->steps = taken;
+			record->end = ALIQUOT_OPEN;
+			return;
+		}
+
+		if (step(res, hare, &hare, record) == false) {
+			record->steps = taken;
+			record->end = ALIQUOT_OVERFLOW;
+			return;
+		}
+		taken++;
+
+		if (hare > record->peak) {
+			record->peak = hare;
+		}
+
+		if (hare == tortoise) {
+			break;
+		}
+
+		if (power == lambda) {
+			tortoise = hare;
+			power *= 2;
+			lambda = 0;
+		}
+		lambda++;
+	}
+
+	// Start the hare lambda steps ahead, then step both until they meet at
+	// the first term of the cycle. Every term is cached by now.
+	tortoise = start;
+	hare = start;
+	for (i = 0; i < lambda; i++) {
+		step(res, hare, &hare, NULL);
+	}
+
+	record->steps = 0;
+	while (tortoise != hare) {
+		step(res, tortoise, &tortoise, NULL);
+		step(res, hare, &hare, NULL);
+		record->steps++;
+	}
+
+	record->cycle = lambda;
+	record->end = ALIQUOT_CYCLE;
+}
+
+static bool step(struct aliquot_res *res, uint64_t n, uint64_t *s,
+		struct aliquot_record *record) {
+	assert(n > 0);
+	assert(s != NULL);
+
+	if (n == 1) {
+		*s = 0;
+		return true;
+	}
+
+	return aliquot_next(res, n, s, record);
+}
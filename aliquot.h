@@ -0,0 +1,186 @@
+/**
+ * @file aliquot.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the aliquot sequence engine and the sigma cache that compute
+ * processes share while running sequences.
+ *
+ */
+#ifndef ALIQUOT_H
+#define ALIQUOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Name of the shared memory object holding the cache. It outlives the
+/// processes using it, so later runs start warm.
+#define ALIQUOT_PATH "albertd-aliquot"
+
+/// log2 of the number of entries in the cache
+#define ALIQUOT_BITS 22
+
+/// Number of entries in the cache, 16 bytes each
+#define ALIQUOT_SLOTS ((uint64_t)1 << ALIQUOT_BITS)
+
+/// Slots tried for a number before it is left out of the cache
+#define ALIQUOT_PROBES 16
+
+/**
+ * Cache entry. n is 0 while the slot is free, and s is 0 until the process
+ * that claimed the slot has stored s(n), since s(n) >= 1 for every n >= 2.
+ */
+struct aliquot_entry {
+	uint64_t n;
+	uint64_t s;
+};
+
+/**
+ * Sigma cache layout structure
+ */
+struct aliquot_res {
+	void *addr;
+	uint64_t *slots;
+	struct aliquot_entry *entries;
+	void *end;
+};
+
+/**
+ * How an aliquot sequence ended
+ */
+enum aliquot_end {
+	ALIQUOT_TERMINATES,	///< Reached 1 by way of a prime
+	ALIQUOT_CYCLE,		///< Entered a cycle of perfect, amicable or sociable numbers
+	ALIQUOT_OVERFLOW,	///< A term's divisor sum does not fit in 64 bits
+	ALIQUOT_OPEN		///< Still going after the step limit
+};
+
+/**
+ * Per-sequence record
+ */
+struct aliquot_record {
+	uint64_t start;			///< First term
+	uint64_t steps;			///< Steps to reach 1, or to enter the cycle
+	uint64_t cycle;			///< Length of the cycle entered, 0 if none
+	uint64_t peak;			///< Largest term seen
+	uint64_t cached;		///< Terms whose sum came from the cache
+	uint64_t computed;		///< Terms whose sum had to be factored
+	enum aliquot_end end;	///< How the sequence ended
+};
+
+/**
+ * @brief Computes the size of the cache object
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param slots Number of entries in the cache
+ * @return Size of the cache object in bytes
+ */
+size_t aliquot_size(uint64_t slots);
+
+/**
+ * @brief Sets resource locations in res for a mapped cache object
+ *
+ * Preconditions: res is not NULL, addr points to a mapping of
+ * aliquot_size(slots) bytes
+ *
+ * Postconditions: Resource locations have been set in res
+ *
+ * @param res Pointer to cache resource structure
+ * @param addr Address the cache object is mapped at
+ * @param slots Number of entries in the cache
+ */
+void aliquot_map(struct aliquot_res *res, void *addr, uint64_t slots);
+
+/**
+ * @brief Opens and mmaps the cache object, creating it if needed
+ *
+ * Every process sizes the object the same way, so it does not matter which
+ * one creates it.
+ *
+ * Preconditions: res is not NULL
+ *
+ * Postconditions: The cache has been mapped and resource locations have been
+ * set in res, or an error has been reported
+ *
+ * @param res Pointer to cache resource structure
+ * @return true on success, false otherwise
+ */
+bool aliquot_attach(struct aliquot_res *res);
+
+/**
+ * @brief Unmaps the cache object
+ *
+ * Preconditions: res has been attached
+ *
+ * Postconditions: The cache is no longer mapped, the object itself remains
+ *
+ * @param res Pointer to cache resource structure
+ */
+void aliquot_detach(struct aliquot_res *res);
+
+/**
+ * @brief Computes the next term of an aliquot sequence, s(n) = sigma(n) - n
+ *
+ * Looks n up in the cache first, and otherwise factors it and publishes the
+ * result. Slots are claimed with a compare and swap on n and filled with a
+ * release store of s, so no lock is taken and readers never see a partial
+ * entry.
+ *
+ * Preconditions: res has been attached, n is at least 2, s is not NULL
+ *
+ * Postconditions: s holds s(n) if it fits
+ *
+ * @param res Pointer to cache resource structure
+ * @param n Current term
+ * @param s Pointer to load the next term into
+ * @param record Record whose cached or computed counter to bump, may be NULL
+ * @return false if s(n) does not fit in 64 bits, true otherwise
+ */
+bool aliquot_next(struct aliquot_res *res, uint64_t n, uint64_t *s,
+		struct aliquot_record *record);
+
+/**
+ * @brief Follows an aliquot sequence until it ends or runs too long
+ *
+ * Detects cycles with Brent's algorithm, which keeps two terms rather than
+ * the whole sequence, then walks the sequence a second time from the start,
+ * served by the cache, to find where the cycle begins.
+ *
+ * Preconditions: res has been attached, start is positive, record is not NULL
+ *
+ * Postconditions: record describes the sequence
+ *
+ * @param res Pointer to cache resource structure
+ * @param start First term
+ * @param max_steps Steps to take before giving up on the sequence
+ * @param record Record to fill in
+ */
+void aliquot_run(struct aliquot_res *res, uint64_t start, uint64_t max_steps,
+		struct aliquot_record *record);
+
+#endif // ALIQUOT_H
@@ -0,0 +1,218 @@
+/**
+ * @file amicable.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Defines the table manage uses to match amicable pairs whose members were
+ * tested in different ranges.
+ *
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "amicable.h"
+#include "factor.h"
+
+/// The table stops taking claims once this many slots are in use, which
+/// keeps linear probe runs short
+#define AMICABLE_FULL (AMICABLE_SLOTS / 4 * 3)
+
+/**
+ * @brief Finds a claim waiting for a number, or the empty slot ending its run
+ *
+ * Preconditions: join has been initialized, n is positive
+ *
+ * Postconditions:
+ *
+ * @param join Table to search
+ * @param n Partner the claim waits for
+ * @return Index of a slot keyed by n if there is one, of an empty slot
+ * otherwise
+ */
+static size_t find_slot(const struct amicable_join *join, uint64_t n);
+
+/**
+ * @brief Removes the claim in a slot, keeping later claims reachable
+ *
+ * Moves each following claim in the probe run back into the hole it would
+ * otherwise be cut off by, so no tombstones are needed.
+ *
+ * Preconditions: join has been initialized, slot holds a claim
+ *
+ * Postconditions: The claim has been removed
+ *
+ * @param join Table to remove from
+ * @param slot Index of the claim to remove
+ */
+static void remove_slot(struct amicable_join *join, size_t slot);
+
+/**
+ * @brief Hashes a number to its home slot
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to hash
+ * @return Index of the first slot to probe for n
+ */
+static size_t home_slot(uint64_t n);
+
+bool amicable_init(struct amicable_join *join, uint64_t limit) {
+	assert(join != NULL);
+
+	join->keys = calloc(AMICABLE_SLOTS, sizeof(uint64_t));
+	join->values = malloc(AMICABLE_SLOTS * sizeof(uint64_t));
+	if ((join->keys == NULL) || (join->values == NULL)) {
+		perror("Could not allocate amicable join table");
+		free(join->keys);
+		free(join->values);
+		return false;
+	}
+
+	join->used = 0;
+	join->limit = limit;
+	join->full = false;
+
+	return true;
+}
+
+bool amicable_claim(struct amicable_join *join, uint64_t n, uint64_t s,
+		uint64_t *a, uint64_t *b) {
+	unsigned __int128 sigma;
+	bool found = false;
+	size_t slot;
+
+	assert(join != NULL);
+	assert(n > 0);
+	assert(a != NULL);
+	assert(b != NULL);
+
+	// The partner is never tested, so the pair could not be confirmed
+	if ((s < 2) || (s > join->limit) || (s == n)) {
+		return false;
+	}
+
+	*a = (n < s) ? n : s;
+	*b = (n < s) ? s : n;
+
+	// Settle every claim waiting for this one. Only the one from s can match,
+	// and the rest never will now that n has claimed.
+	slot = find_slot(join, n);
+	while (join->keys[slot] == n) {
+		if (join->values[slot] == s) {
+			found = true;
+		}
+		remove_slot(join, slot);
+		slot = find_slot(join, n);
+	}
+
+	if (found == true) {
+		return true;
+	}
+
+	if (join->full == false) {
+		if (join->used < AMICABLE_FULL) {
+			// Past any other claims already waiting for s
+			slot = home_slot(s);
+			while (join->keys[slot] != 0) {
+				slot = (slot + 1) & (AMICABLE_SLOTS - 1);
+			}
+			join->keys[slot] = s;
+			join->values[slot] = n;
+			join->used++;
+			return false;
+		}
+
+		fprintf(stderr, "[manage] Amicable join table full, factoring partners instead\n");
+		join->full = true;
+	}
+
+	// Stored claims still match above, but from here on only the smaller
+	// member checks its partner, so each pair is reported once
+	if (n > s) {
+		return false;
+	}
+
+	sigma = factor_sigma(s);
+	return (sigma - s == n);
+}
+
+void amicable_free(struct amicable_join *join) {
+	assert(join != NULL);
+
+	free(join->keys);
+	free(join->values);
+	join->keys = NULL;
+	join->values = NULL;
+	join->used = 0;
+}
+
+static size_t find_slot(const struct amicable_join *join, uint64_t n) {
+	size_t slot;
+
+	assert(join != NULL);
+	assert(n > 0);
+
+	slot = home_slot(n);
+	while ((join->keys[slot] != 0) && (join->keys[slot] != n)) {
+		slot = (slot + 1) & (AMICABLE_SLOTS - 1);
+	}
+
+	return slot;
+}
+
+static void remove_slot(struct amicable_join *join, size_t slot) {
+	size_t next;
+	size_t home;
+
+	assert(join != NULL);
+	assert(join->keys[slot] != 0);
+
+	next = slot;
+	while (1) {
+		next = (next + 1) & (AMICABLE_SLOTS - 1);
+		if (join->keys[next] == 0) {
+			break;
+		}
+
+		// A claim can fill the hole only if the hole lies between its home
+		// slot and where it sits now, going around the end if needed
+		home = home_slot(join->keys[next]);
+		if (((next - home) & (AMICABLE_SLOTS - 1)) >=
+				((next - slot) & (AMICABLE_SLOTS - 1))) {
+			join->keys[slot] = join->keys[next];
+			join->values[slot] = join->values[next];
+			slot = next;
+		}
+	}
+
+	join->keys[slot] = 0;
+	join->used--;
+}
+
+static size_t home_slot(uint64_t n) {
+	// Fibonacci hashing spreads consecutive numbers across the table
+	return (size_t)((n * 0x9e3779b97f4a7c15ULL) >> (64 - AMICABLE_BITS));
+}
@@ -0,0 +1,103 @@
+/**
+ * @file amicable.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the table manage uses to match amicable pairs whose members were
+ * tested in different ranges.
+ *
+ */
+#ifndef AMICABLE_H
+#define AMICABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// log2 of the number of claims the join table holds
+#define AMICABLE_BITS 20
+
+/// Number of claims the join table holds, 16 bytes each
+#define AMICABLE_SLOTS ((size_t)1 << AMICABLE_BITS)
+
+/**
+ * Join table of claims still waiting for their partner's claim
+ *
+ * A claim (n, s) says that s(n) = sigma(n) - n is s. Claims wait under s,
+ * the number whose own claim decides them, and every claim waiting under n
+ * is settled and dropped once n's claim arrives. Once the table fills it
+ * stops taking new claims for good, and each claim from the smaller member
+ * is instead checked by factoring its partner.
+ */
+struct amicable_join {
+	uint64_t *keys;		///< Partner each claim waits for, 0 marks an empty slot
+	uint64_t *values;	///< Number that made the claim in the same slot
+	size_t used;		///< Number of slots in use
+	uint64_t limit;		///< Highest number tested, larger partners are ignored
+	bool full;			///< Set once the table has filled
+};
+
+/**
+ * @brief Allocates an empty join table
+ *
+ * Preconditions: join is not NULL
+ *
+ * Postconditions: The table is empty, or an error has been reported
+ *
+ * @param join Table to initialize
+ * @param limit Highest number that will be tested
+ * @return true on success, false otherwise
+ */
+bool amicable_init(struct amicable_join *join, uint64_t limit);
+
+/**
+ * @brief Records a claim and checks it against its partner
+ *
+ * Preconditions: join has been initialized, n is positive, a is not NULL,
+ * b is not NULL
+ *
+ * Postconditions: The claim has been matched, stored or dropped
+ *
+ * @param join Table to record the claim in
+ * @param n Number making the claim
+ * @param s Aliquot sum of n
+ * @param a Smaller member of the pair, set when one is confirmed
+ * @param b Larger member of the pair, set when one is confirmed
+ * @return true if the claim completed an amicable pair, false otherwise
+ */
+bool amicable_claim(struct amicable_join *join, uint64_t n, uint64_t s,
+		uint64_t *a, uint64_t *b);
+
+/**
+ * @brief Releases a join table
+ *
+ * Preconditions: join is not NULL
+ *
+ * Postconditions: The table's memory has been freed
+ *
+ * @param join Table to release
+ */
+void amicable_free(struct amicable_join *join);
+
+#endif // AMICABLE_H
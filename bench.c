@@ -0,0 +1,591 @@
+/**
+ * @file bench.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Times each divisor-sum kernel on its own over a few fixed neighbourhoods
+ * and reports candidates per second, nanoseconds and TSC cycles per
+ * candidate, as a table or as JSON for tracking regressions.
+ *
+ */
+#include <assert.h>
+#include <inttypes.h> // For PRIu64
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sigma.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc()
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+/// Candidates each measurement tests unless -n says otherwise
+#define COUNT_DEFAULT 1000000
+
+/// Seconds a measurement may run before it stops early, unless -t says
+/// otherwise
+#define BUDGET_DEFAULT 0.5
+
+/// Most candidates tested between looks at the clock. Measurements start at
+/// one and double up to this, so slow kernels still stop close to the budget.
+#define CHUNK 1024
+
+/// Numbers sieved at once, the same as compute's segment
+#define SEGMENT 16384
+
+/// The highly composite suite stops below this, where the prime kernel's
+/// table and the pair kernel's scans are still cheap to set up
+#define COMPOSITE_LIMIT ((uint64_t)1 << 40)
+
+/// Largest number of highly composite numbers below COMPOSITE_LIMIT
+#define NCOMPOSITE 128
+
+/// Largest number of Hardy-Ramanujan numbers below COMPOSITE_LIMIT
+#define NSMOOTH 8192
+
+/**
+ * Kernel entry point being timed
+ */
+enum method {
+	METHOD_TEST,	///< kernel->test, one candidate at a time
+	METHOD_BATCH,	///< kernel->batch, KERNEL_BATCH candidates at a time
+	METHOD_SIEVE	///< kernel->sieve, SEGMENT numbers at a time
+};
+
+/**
+ * Set of candidates a kernel is timed on
+ */
+struct suite {
+	const char *name;	///< Name used to select the suite with -s
+	uint64_t start;		///< First candidate, 0 for the highly composite list
+};
+
+/**
+ * Outcome of one measurement
+ */
+struct result {
+	uint64_t candidates;	///< Candidates tested before the count or budget ran out
+	uint64_t found;			///< Perfect numbers among them, so no work is optimized out
+	double seconds;			///< Wall clock time taken
+	uint64_t cycles;		///< TSC ticks taken, 0 without a TSC
+};
+
+/**
+ * @brief Builds the list of highly composite numbers below COMPOSITE_LIMIT
+ *
+ * Every highly composite number is 2^a * 3^b * 5^c ... with a >= b >= c ...,
+ * so those are generated first and then kept only where the divisor count
+ * sets a record.
+ *
+ * Preconditions:
+ *
+ * Postconditions: composite and ncomposite have been set
+ */
+void composite_init(void);
+
+/**
+ * @brief Adds every Hardy-Ramanujan number n * p^e ... below COMPOSITE_LIMIT
+ *
+ * Preconditions: n is below COMPOSITE_LIMIT, divisors is the number of
+ * divisors of n
+ *
+ * Postconditions: The numbers have been added to smooth
+ *
+ * @param n Product so far
+ * @param divisors Number of divisors of n
+ * @param prime Index into primes of the next prime to multiply in
+ * @param max_exponent Highest exponent the next prime may have
+ */
+void composite_walk(uint64_t n, uint64_t divisors, unsigned int prime,
+		unsigned int max_exponent);
+
+/**
+ * @brief Compares two smooth numbers by value, for qsort()
+ *
+ * Preconditions: a and b point to struct smooth
+ *
+ * Postconditions:
+ *
+ * @param a First number
+ * @param b Second number
+ * @return Negative, zero or positive as a is below, equal to or above b
+ */
+int composite_compare(const void *a, const void *b);
+
+/**
+ * @brief Times one kernel entry point on one suite
+ *
+ * Tests candidates from the suite until count have been tested or budget
+ * seconds have passed, whichever comes first.
+ *
+ * Preconditions: kernel is not NULL, suite is not NULL, result is not NULL,
+ * the kernel has the entry point for method
+ *
+ * Postconditions: result holds the measurement
+ *
+ * @param kernel Kernel to time
+ * @param method Entry point to time
+ * @param suite Candidates to time it on
+ * @param result Pointer to load the measurement into
+ */
+void bench_run(const struct kernel *kernel, enum method method,
+		const struct suite *suite, struct result *result);
+
+/**
+ * @brief Prints a measurement as a table row or a JSON object
+ *
+ * Preconditions: kernel, suite and result are not NULL
+ *
+ * Postconditions: The measurement has been written to stdout
+ *
+ * @param kernel Kernel timed
+ * @param method Entry point timed
+ * @param suite Candidates it was timed on
+ * @param result Measurement
+ */
+void bench_print(const struct kernel *kernel, enum method method,
+		const struct suite *suite, const struct result *result);
+
+/**
+ * @brief Reads the time stamp counter
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return TSC ticks, or 0 without a TSC
+ */
+uint64_t read_tsc(void);
+
+/**
+ * @brief Reads the monotonic clock
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return Seconds since an arbitrary point
+ */
+double read_clock(void);
+
+/**
+ * @brief Displays usage information and exits
+ *
+ * Preconditions:
+ *
+ * Postconditions: Usage information has been printed and the program has
+ * exited
+ */
+void usage(void);
+
+/**
+ * Number generated while building the highly composite list
+ */
+struct smooth {
+	uint64_t n;
+	uint64_t divisors;
+};
+
+/// Candidate sets, in the order they are run
+const struct suite suites[] = {
+	{ "small", 1 },
+	{ "1e6", 1000000 },
+	{ "1e8", 100000000 },
+	{ "1e12", 1000000000000ULL },
+	{ "composite", 0 },
+};
+
+/// Number of entries in suites
+#define NSUITES (sizeof(suites) / sizeof(suites[0]))
+
+/// Names of the entry points, indexed by enum method
+const char *method_names[] = { "test", "batch", "sieve" };
+
+/// Primes that can divide a Hardy-Ramanujan number below COMPOSITE_LIMIT
+const uint64_t primes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+
+/// Number of entries in primes
+#define NPRIMES (sizeof(primes) / sizeof(primes[0]))
+
+/// Hardy-Ramanujan numbers, filled by composite_walk()
+struct smooth smooth[NSMOOTH];
+
+/// Number of entries in smooth
+unsigned int nsmooth = 0;
+
+/// Highly composite numbers below COMPOSITE_LIMIT
+uint64_t composite[NCOMPOSITE];
+
+/// Number of entries in composite
+unsigned int ncomposite = 0;
+
+/// Candidates each measurement tests, set with -n
+uint64_t count = COUNT_DEFAULT;
+
+/// Seconds each measurement may take, set with -t
+double budget = BUDGET_DEFAULT;
+
+/// Whether to print JSON instead of a table, set with -j
+bool json = false;
+
+/// Whether a JSON object has been printed yet, to place the commas
+bool first_row = true;
+
+/**
+ * @brief Entry point for the program
+ *
+ * Parses arguments and times each selected kernel entry point on each
+ * selected suite.
+ *
+ * Preconditions:
+ *
+ * Postconditions: The measurements have been printed
+ *
+ * @param argc Number of arguments supplied
+ * @param argv List of arguments supplied
+ * @return Exit status
+ */
+int main(int argc, char **argv) {
+	struct result result;
+	const struct kernel *only = NULL;
+	const struct kernel *kernel;
+	const char *suite_name = NULL;
+	enum isa isa = isa_detect();
+	uint64_t end;
+	unsigned int i;
+	unsigned int j;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:jk:n:s:t:")) != -1) {
+		switch (opt) {
+		case 'i':
+			if (isa_find(optarg, &isa) == false) {
+				fprintf(stderr, "Unknown instruction set: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'j':
+			json = true;
+			break;
+		case 'k':
+			only = kernel_find(optarg);
+			if (only == NULL) {
+				fprintf(stderr, "Unknown kernel: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'n':
+			count = strtoull(optarg, NULL, 0);
+			if (count == 0) {
+				fprintf(stderr, "Invalid count: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 's':
+			suite_name = optarg;
+			for (j = 0; j < NSUITES; j++) {
+				if (strcmp(suites[j].name, suite_name) == 0) {
+					break;
+				}
+			}
+			if (j == NSUITES) {
+				fprintf(stderr, "Unknown suite: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 't':
+			budget = strtod(optarg, NULL);
+			if (budget <= 0) {
+				fprintf(stderr, "Invalid budget: %s\n", optarg);
+				usage();
+			}
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	if (optind != argc) {
+		usage();
+	}
+
+	if (kernel_dispatch(isa) == false) {
+		exit(EXIT_FAILURE);
+	}
+
+	composite_init();
+
+	if (json == true) {
+		printf("[\n");
+	} else {
+		printf("%-8s %-6s %-10s %12s %14s %10s %12s %6s\n", "kernel", "method", "suite",
+				"candidates", "candidates/s", "ns/cand", "cycles/cand", "found");
+	}
+
+	for (j = 0; j < NSUITES; j++) {
+		if ((suite_name != NULL) && (strcmp(suites[j].name, suite_name) != 0)) {
+			continue;
+		}
+
+		if (suites[j].start == 0) {
+			end = composite[ncomposite - 1];
+		} else {
+			end = suites[j].start + count - 1;
+		}
+
+		for (i = 0; (kernel = kernel_at(i)) != NULL; i++) {
+			// The naive kernel takes O(n) per candidate, so it only runs
+			// when asked for
+			if ((only != NULL) ? (kernel != only) : (strcmp(kernel->name, "naive") == 0)) {
+				continue;
+			}
+
+			if ((kernel->init != NULL) && (kernel->init(end) == false)) {
+				fprintf(stderr, "Skipping %s on %s\n", kernel->name, suites[j].name);
+				continue;
+			}
+
+			bench_run(kernel, METHOD_TEST, &suites[j], &result);
+			bench_print(kernel, METHOD_TEST, &suites[j], &result);
+
+			if (kernel->batch != NULL) {
+				bench_run(kernel, METHOD_BATCH, &suites[j], &result);
+				bench_print(kernel, METHOD_BATCH, &suites[j], &result);
+			}
+
+			// Sieves need a contiguous range
+			if ((kernel->sieve != NULL) && (suites[j].start != 0)) {
+				bench_run(kernel, METHOD_SIEVE, &suites[j], &result);
+				bench_print(kernel, METHOD_SIEVE, &suites[j], &result);
+			}
+		}
+	}
+
+	if (json == true) {
+		printf("\n]\n");
+	}
+
+	exit(EXIT_SUCCESS);
+}
+
+void composite_init(void) {
+	uint64_t record = 0;
+	unsigned int i;
+
+	composite_walk(1, 1, 0, UINT32_MAX);
+	qsort(smooth, nsmooth, sizeof(smooth[0]), composite_compare);
+
+	for (i = 0; i < nsmooth; i++) {
+		if ((smooth[i].divisors > record) && (ncomposite < NCOMPOSITE)) {
+			record = smooth[i].divisors;
+			composite[ncomposite++] = smooth[i].n;
+		}
+	}
+}
+
+void composite_walk(uint64_t n, uint64_t divisors, unsigned int prime,
+		unsigned int max_exponent) {
+	unsigned int e;
+
+	assert(n < COMPOSITE_LIMIT);
+
+	if (nsmooth < NSMOOTH) {
+		smooth[nsmooth].n = n;
+		smooth[nsmooth].divisors = divisors;
+		nsmooth++;
+	}
+
+	if (prime == NPRIMES) {
+		return;
+	}
+
+	for (e = 1; e <= max_exponent; e++) {
+		if (n > (COMPOSITE_LIMIT - 1) / primes[prime]) {
+			break;
+		}
+		n *= primes[prime];
+		composite_walk(n, divisors * (e + 1), prime + 1, e);
+	}
+}
+
+int composite_compare(const void *a, const void *b) {
+	const struct smooth *x = a;
+	const struct smooth *y = b;
+
+	return (x->n > y->n) - (x->n < y->n);
+}
+
+void bench_run(const struct kernel *kernel, enum method method,
+		const struct suite *suite, struct result *result) {
+	uint64_t sums[SEGMENT];
+	uint64_t batch[KERNEL_BATCH];
+	uint64_t n = suite->start;
+	uint64_t tsc;
+	double started;
+	unsigned int step = 1;
+	unsigned int chunk;
+	unsigned int mask;
+	unsigned int i;
+	unsigned int j;
+
+	assert(kernel != NULL);
+	assert(suite != NULL);
+	assert(result != NULL);
+
+	result->candidates = 0;
+	result->found = 0;
+
+	started = read_clock();
+	tsc = read_tsc();
+
+	while ((result->candidates < count) && (read_clock() - started < budget)) {
+		chunk = (method == METHOD_SIEVE) ? SEGMENT : step;
+		if (step < CHUNK) {
+			step *= 2;
+		}
+		if (count - result->candidates < chunk) {
+			chunk = count - result->candidates;
+		}
+
+		switch (method) {
+		case METHOD_TEST:
+			for (i = 0; i < chunk; i++) {
+				if (suite->start == 0) {
+					n = composite[(result->candidates + i) % ncomposite];
+				}
+				result->found += kernel->test(n);
+				n += (suite->start != 0);
+			}
+			break;
+		case METHOD_BATCH:
+			for (i = 0; i < chunk; i += KERNEL_BATCH) {
+				for (j = 0; j < KERNEL_BATCH; j++) {
+					if (suite->start == 0) {
+						batch[j] = composite[(result->candidates + i + j) % ncomposite];
+					} else {
+						batch[j] = n + i + j;
+					}
+				}
+				mask = kernel->batch(batch, KERNEL_BATCH);
+				result->found += __builtin_popcount(mask);
+			}
+			// Whole batches only, so the chunk may have been rounded up
+			chunk = i;
+			n += chunk;
+			break;
+		case METHOD_SIEVE:
+			kernel->sieve(sums, n, chunk);
+			for (i = 0; i < chunk; i++) {
+				result->found += (sums[i] == 2 * (n + i));
+			}
+			n += chunk;
+			break;
+		}
+
+		result->candidates += chunk;
+	}
+
+	result->cycles = read_tsc() - tsc;
+	result->seconds = read_clock() - started;
+
+	// Kernels count what they do, which nobody reads here
+	memset(&kernel_stats, 0, sizeof(kernel_stats));
+}
+
+void bench_print(const struct kernel *kernel, enum method method,
+		const struct suite *suite, const struct result *result) {
+	double per_second = result->candidates / result->seconds;
+	double ns = result->seconds * 1e9 / result->candidates;
+	double cycles = (double)result->cycles / result->candidates;
+
+	assert(kernel != NULL);
+	assert(suite != NULL);
+	assert(result != NULL);
+
+	if (json == true) {
+		printf("%s  {\"kernel\": \"%s\", \"method\": \"%s\", \"suite\": \"%s\", "
+				"\"candidates\": %" PRIu64 ", \"seconds\": %.6f, "
+				"\"candidates_per_second\": %.1f, \"ns_per_candidate\": %.3f, "
+				"\"cycles_per_candidate\": %.1f, \"found\": %" PRIu64 "}",
+				(first_row == true) ? "" : ",\n", kernel->name, method_names[method],
+				suite->name, result->candidates, result->seconds, per_second, ns,
+				cycles, result->found);
+		first_row = false;
+	} else {
+		printf("%-8s %-6s %-10s %12" PRIu64 " %14.0f %10.1f %12.1f %6" PRIu64 "\n",
+				kernel->name, method_names[method], suite->name, result->candidates,
+				per_second, ns, cycles, result->found);
+	}
+	fflush(stdout);
+}
+
+uint64_t read_tsc(void) {
+#if HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+double read_clock(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+void usage(void) {
+	unsigned int i;
+
+	printf("Usage: bench [-i isa] [-j] [-k kernel] [-n count] [-s suite] [-t seconds]\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("    -i isa:     instruction set for vector kernels (default: widest\n");
+	printf("                the CPU supports), one of: ");
+	isa_list();
+	printf("    -j:         print JSON instead of a table\n");
+	printf("    -k kernel:  only time this kernel (default all but naive), one of:\n");
+	printf("                ");
+	kernel_list();
+	printf("    -n count:   candidates per measurement (default %d)\n", COUNT_DEFAULT);
+	printf("    -s suite:   only run this suite (default all), one of:\n");
+	printf("                ");
+	for (i = 0; i < NSUITES; i++) {
+		printf("%s ", suites[i].name);
+	}
+	printf("\n");
+	printf("    -t seconds: stop a measurement early after this long (default %.1f)\n",
+			BUDGET_DEFAULT);
+	printf("\n");
+	printf("Cycles are TSC ticks, which run at a fixed rate rather than the core clock.\n");
+	exit(EXIT_FAILURE);
+}
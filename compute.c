@@ -30,16 +30,29 @@
  *
  */
 #include <assert.h>
+#include <ctype.h> // For isdigit() and isspace()
 #include <errno.h>
+#include <inttypes.h> // For PRIu64
+#include <limits.h> // For UINT_MAX
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h> // For clock_gettime()
 #include <unistd.h>
+#include "affinity.h"
+#include "aliquot.h"
+#include "factor.h"
+#include "mersenne.h"
 #include "packets.h"
+#include "pool.h"
+#include "prefilter.h"
 #include "shmem.h"
+#include "sigma.h"
 #include "sock.h"
+#include "table.h"
 
 /// Minimum number of arguments this program needs to run
 #define ARGC_MIN 2
@@ -62,34 +75,186 @@
 /// Index of address argument in argv
 #define ADDR_ARG 2
 
-/// The maximum number of divisors to store
-#define MAX_DIVISORS 10000
+/// Number of candidates sieved at once, sized so the sums fit in L2 cache
+#define SIEVE_SEGMENT 16384
+
+/// Smallest piece the worker pool splits a range into, a whole number of sieve
+/// segments so that every piece but the last sieves full segments
+#define POOL_CHUNK (16 * SIEVE_SEGMENT)
+
+/// Ranges a socket client holds by default, one being tested and one on its
+/// way, so the next range is ready as soon as the current one is done
+#define PREFETCH_DEFAULT 2
+
+/// Candidates from here on are factored with rho unless -r says otherwise.
+/// Around 2^48 rho overtakes the sieve at about 7 us per candidate.
+#define RHO_THRESHOLD_DEFAULT ((uint64_t)1 << 48)
+
+/// An amicable partner m of n has sigma(m) / m = 1 + n / m, and no m below
+/// 2^64 reaches this abundancy, so n never pairs with an m <= n / 6
+#define ABUNDANCY_MAX 7
+
+/// Steps an aliquot sequence may take before it is reported as open
+#define ALIQUOT_STEPS 2000
+
+/// Largest number of characters in a line of verify mode input
+#define VERIFY_LINE 64
+
+/**
+ * Signature of the functions that send a result to manage. sigma(n) is k * n,
+ * so k is 2 for perfect numbers. exponent is p when n is 2^(p-1)(2^p-1) and 0
+ * otherwise; n is 0 if it does not fit.
+ */
+typedef void (*report_fn)(int fd, uint64_t n, unsigned int exponent, unsigned int k);
+
+/**
+ * Range assignment the worker pool is splitting up, passed to range_worker()
+ */
+struct range_job {
+	int fd;				///< File descriptor to report on
+	report_fn report;	///< Function used to report each number found
+	uint64_t start;		///< First number of the assignment
+	uint64_t end;		///< Last number of the assignment
+	struct gap *gaps;	///< Pieces left untested, protected by stats_lock
+	unsigned int ngaps;	///< Number of pieces in gaps
+	unsigned int size;	///< Number of pieces gaps has room for
+	bool lost;			///< A piece could not be recorded in gaps
+};
+
+/**
+ * Shared memory slot the worker pool is testing for, passed to shmem_worker()
+ */
+struct shmem_job {
+	struct shmem_res *res;	///< Shared memory resource structure
+	struct process *p;		///< This process's entry in the process list
+};
+
+/**
+ * @brief Checks if 2^p - 1 is a Mersenne prime, trial factoring it first
+ *
+ * Looks for a factor of the form 2kp + 1 up to factor_depth bits, or the
+ * depth mersenne_depth() picks, and only runs the Lucas-Lehmer test if none
+ * turns up. kernel_stats records how many exponents were ruled out and how
+ * long the trial factoring took.
+ *
+ * Preconditions:
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param p Exponent to test
+ * @return true if 2^p - 1 is prime, false otherwise
+ */
+bool test_exponent(uint64_t p);
 
 /**
- * @brief Checks if an integer is a perfect number.
+ * @brief Pins this process's threads and starts the worker pool
+ *
+ * Thread i is pinned to the CPU the -c policy picks for slot + i, and with
+ * bind also allocates its memory on that CPU's NUMA node. With a single
+ * thread no pool is started and the calling thread is pinned instead.
  *
- * Preconditions: 
+ * Preconditions: nthreads is positive
  *
- * Postconditions: 
+ * Postconditions: The threads have been pinned and any pool started
  *
- * @param n Number to test
- * @return true if n is a perfect number, false otherwise
+ * @param slot Policy slot of the first thread
+ * @param bind Whether to bind each thread's memory to its node
+ * @return true on success, false if the pool could not be started
  */
-bool is_perfect_number(unsigned int n);
+bool start_threads(unsigned int slot, bool bind);
 
 /**
- * @brief Funds and claims a number for testing
+ * @brief Finds and claims a batch of numbers for testing
  *
- * Scans through shared memory object for an untested number and claims it.
+ * Scans through shared memory object for a byte of the bitmap with untested
+ * numbers and claims all of them at once, so the semaphore is taken once per
+ * batch instead of once per number.
  *
- * Preconditions: res is not NULL, shared memory initialized
+ * Preconditions: res is not NULL, shared memory initialized, tests has room for
+ * 8 numbers
  *
- * Postconditions: A number has been selected or all numbers have been tested
+ * Postconditions: Numbers have been selected or all numbers have been tested
  *
  * @param res Pointer to shared memory resource structure
- * @return Number to test or -1 if all numbers have been tested
+ * @param tests Array to load the claimed numbers into
+ * @return Number of numbers claimed, 0 if all numbers have been tested
+ */
+unsigned int next_batch(struct shmem_res *res, uint64_t *tests);
+
+/**
+ * @brief Tests a batch of candidates
+ *
+ * When searching integers, candidates are first run through the enabled
+ * prefilter stages, and only those that pass reach test_kernel().
+ *
+ * Preconditions: n is not NULL, count is positive and at most KERNEL_BATCH,
+ * n is in increasing order
+ *
+ * Postconditions:
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number or the exponent of one
  */
-int next_test(struct shmem_res *res);
+unsigned int test_batch(const uint64_t *n, unsigned int count);
+
+/**
+ * @brief Tests a batch of candidates with the selected kernel
+ *
+ * Uses the kernel's batch function when it has one, and the Lucas-Lehmer test
+ * when searching exponents. Candidates at or above rho_threshold are factored
+ * with rho_is_perfect() instead.
+ *
+ * Preconditions: n is not NULL, count is positive and at most KERNEL_BATCH,
+ * n is in increasing order
+ *
+ * Postconditions:
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number or the exponent of one
+ */
+unsigned int test_kernel(const uint64_t *n, unsigned int count);
+
+/**
+ * @brief Finds the k-perfect numbers in a batch of candidates
+ *
+ * Kernels only decide whether sigma(n) is 2n, so when no sieve is available
+ * each candidate is factored with factor_sigma() instead.
+ *
+ * Preconditions: n is not NULL, k is not NULL, count is positive and at most
+ * KERNEL_BATCH
+ *
+ * Postconditions: k[i] has been set for every bit set in the result
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @param k Array to load sigma(n[i]) / n[i] into
+ * @return Mask with bit i set if sigma(n[i]) is k * n[i] for some k >= 2
+ */
+unsigned int test_multiperfect(const uint64_t *n, unsigned int count, unsigned int *k);
+
+/**
+ * @brief Finds the perfect or k-perfect numbers in a batch with the sieve
+ *
+ * Sieves the span from n[0] to n[count - 1] and classifies every candidate
+ * from the sums, so the counts cover the whole batch rather than only what
+ * the prefilters would have passed. Like range_loop(), the sieve ignores the
+ * prefilters.
+ *
+ * Preconditions: n is not NULL, k is not NULL, count is positive and at most
+ * KERNEL_BATCH, n is in increasing order and spans at most KERNEL_BATCH
+ * numbers, the kernel has a sieve, n[count - 1] is below SIEVE_LIMIT
+ *
+ * Postconditions: k[i] has been set for every bit set in the result
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @param k Array to load sigma(n[i]) / n[i] into
+ * @return Mask with bit i set if sigma(n[i]) is 2 * n[i], or k * n[i] for some
+ * k >= 2 when searching for multiperfect numbers
+ */
+unsigned int sieve_batch(const uint64_t *n, unsigned int count, unsigned int *k);
 
 /**
  * @brief Main loop for shared memory
@@ -106,19 +271,293 @@ int next_test(struct shmem_res *res);
  */
 void shmem_loop(struct shmem_res *res);
 
+/**
+ * @brief Claims and tests batches from shared memory until none are left
+ *
+ * Every thread of the process runs this loop on the same process list entry,
+ * adding to its counters under stats_lock.
+ *
+ * Preconditions: res is not NULL, shared memory is initialized, p is this
+ * process's entry in the process list
+ *
+ * Postconditions: All numbers have been claimed or a signal was caught
+ *
+ * @param res Pointer to shared memory resource structure
+ * @param p This process's entry in the process list
+ */
+void shmem_work(struct shmem_res *res, struct process *p);
+
+/**
+ * @brief Runs shmem_work() on a worker thread
+ *
+ * Preconditions: arg is a struct shmem_job
+ *
+ * Postconditions: All numbers have been claimed or a signal was caught
+ *
+ * @param start Unused, each worker is handed one number
+ * @param end Unused
+ * @param arg Shared memory slot to test for
+ * @return true unless a signal was caught
+ */
+bool shmem_worker(uint64_t start, uint64_t end, void *arg);
+
 /**
  * @brief Reports perfect number to shared memory object
  *
+ * Perfect numbers go in the perfect numbers list and other k-perfect numbers
+ * in the multiperfect list.
+ *
  * Preconditions: res is not NULL, shared memory is initialized, n is positive,
- * there is room for another number in the list
+ * k is at least 2, there is room for another number in the list
  *
- * Postconditions: The number has been placed in the perfect numbers list
+ * Postconditions: The number has been placed in its list
  *
  * @param res Pointer to shared memory resource structure
  * @param n Number to report
+ * @param k sigma(n) / n
  * @return true on success, false otherwise
  */
-bool shmem_report(struct shmem_res *res, int n);
+bool shmem_report(struct shmem_res *res, uint64_t n, unsigned int k);
+
+/**
+ * @brief Tests every number in a range with the selected kernel
+ *
+ * Uses the kernel's range sieve when it has one, one segment at a time, and
+ * otherwise tests the numbers in batches. When searching exponents, each
+ * number is instead a Mersenne exponent checked with the Lucas-Lehmer test.
+ * Stops early if a signal is caught. Ranges reaching SIEVE_LIMIT or
+ * rho_threshold are tested in batches even if the kernel has a sieve. So are
+ * all ranges while the euclid prefilter is enabled, since it leaves too few
+ * candidates for a sieve to pay off. The other stages still leave a few
+ * percent, so the sieve stays faster and ignores them. When searching for
+ * k-perfect numbers the sums the sieve already produced are checked for any
+ * multiple of n, and ranges it cannot cover are factored with
+ * test_multiperfect(). When searching for amicable pairs, pairs whose members
+ * are both in the segment just sieved are checked there, and every other
+ * aliquot sum is sent to manage to be matched with its partner's. With a
+ * table, a range tested by an earlier run is answered from it when searching
+ * integers, and every range tested adds its perfect numbers to it.
+ *
+ * A range stopped early still sends its queued aliquot sums and marks the
+ * part it finished in the table, and stopped tells where that part ends.
+ *
+ * Preconditions: start is positive, end is not less than start, fd is valid,
+ * stopped is not NULL
+ *
+ * Postconditions: Each number in the range has been tested and reported as
+ * necessary, or a signal was caught and every number before stopped has been
+ * tested
+ *
+ * @param fd File descriptor to report perfect numbers on
+ * @param start First number to test
+ * @param end Last number to test
+ * @param report Function used to report each perfect or k-perfect number found
+ * @param stopped Pointer to load the first number not tested into if the range
+ * was stopped early
+ * @return true if the whole range was tested, false if a signal was caught
+ */
+bool test_range(int fd, uint64_t start, uint64_t end, report_fn report, uint64_t *stopped);
+
+/**
+ * @brief Finishes a range test_range() ran up to n
+ *
+ * Preconditions: fd is valid, stopped is not NULL
+ *
+ * Postconditions: Queued aliquot sums have been sent and the numbers tested
+ * marked in the table
+ *
+ * @param fd File descriptor the range reported on
+ * @param start First number of the range
+ * @param n First number the loop did not test
+ * @param end Last number of the range
+ * @param stopped Pointer to load n into if the range was stopped early
+ * @return true if the loop ran past end, false otherwise
+ */
+bool finish_range(int fd, uint64_t start, uint64_t n, uint64_t end, uint64_t *stopped);
+
+/**
+ * @brief Tests an assigned range on the worker pool
+ *
+ * The range is split between the workers, which steal from each other when
+ * they run out, down to pieces of POOL_CHUNK numbers, or single exponents
+ * when searching exponents. Each piece is tested with test_range(), and the
+ * range only counts as done once every stolen piece has finished. The kernel
+ * is prepared for the whole range first, so workers never grow its tables
+ * while others read them. Without a pool the range is tested on this thread.
+ * If a signal stops it early, a remainder packet goes to manage for each
+ * piece left untested, so manage can hand out just those numbers again.
+ *
+ * Preconditions: start is positive, end is not less than start, fd is valid
+ *
+ * Postconditions: Each number in the range has been tested and reported as
+ * necessary, or a signal was caught
+ *
+ * @param fd File descriptor to report perfect numbers on
+ * @param start First number to test
+ * @param end Last number to test
+ * @param report Function used to report each perfect or k-perfect number found
+ * @return true if the whole range was tested, false otherwise
+ */
+bool test_assignment(int fd, uint64_t start, uint64_t end, report_fn report);
+
+/**
+ * @brief Runs test_range() on a piece of an assignment on a worker thread
+ *
+ * Preconditions: arg is a struct range_job
+ *
+ * Postconditions: The piece has been tested and the thread's counters merged
+ * into pool_stats, or whatever was not tested has been added to the gaps
+ *
+ * @param start First number to test
+ * @param end Last number to test
+ * @param arg Assignment the piece belongs to
+ * @return true if the whole piece was tested, false otherwise
+ */
+bool range_worker(uint64_t start, uint64_t end, void *arg);
+
+/**
+ * @brief Records a piece of an assignment left untested
+ *
+ * Preconditions: job is not NULL, stats_lock is held if workers are running
+ *
+ * Postconditions: The piece is in job's gaps, or job is marked lost
+ *
+ * @param job Assignment the piece belongs to
+ * @param start First number not tested
+ * @param end Last number not tested
+ */
+void add_gap(struct range_job *job, uint64_t start, uint64_t end);
+
+/**
+ * @brief Tells manage which parts of an assignment were left untested
+ *
+ * Adjacent pieces are merged, so a range stopped by a signal usually needs
+ * only one packet per worker. If a piece could not be recorded, the whole
+ * assignment is sent back instead.
+ *
+ * Preconditions: fd is valid, job is not NULL
+ *
+ * Postconditions: A remainder packet has been sent for each untested range
+ *
+ * @param fd File descriptor to send on
+ * @param job Assignment that was stopped
+ */
+void send_remainder(int fd, struct range_job *job);
+
+/**
+ * @brief Orders gaps by their first number
+ *
+ * Preconditions: a and b are not NULL
+ *
+ * Postconditions:
+ *
+ * @param a First struct gap
+ * @param b Second struct gap
+ * @return Negative, zero or positive as a starts before, with or after b
+ */
+int gap_compare(const void *a, const void *b);
+
+/**
+ * @brief Queues n's aliquot sum for manage to match against its partner
+ *
+ * Sums that cannot belong to an amicable pair are dropped: primes, whose sum
+ * is 1, and numbers whose partner would need an abundancy of ABUNDANCY_MAX.
+ * Full packets are sent as they fill.
+ *
+ * Preconditions: fd is valid, n is positive, s is not n
+ *
+ * Postconditions: The sum has been queued or dropped
+ *
+ * @param fd File descriptor to send the sums on
+ * @param n Number tested
+ * @param s sigma(n) - n
+ */
+void send_aliquot(int fd, uint64_t n, uint64_t s);
+
+/**
+ * @brief Sends any aliquot sums still queued
+ *
+ * Preconditions: fd is valid
+ *
+ * Postconditions: The queue is empty
+ *
+ * @param fd File descriptor to send the sums on
+ */
+void flush_aliquot(int fd);
+
+/**
+ * @brief Reports an amicable pair confirmed without help from manage
+ *
+ * Preconditions: fd is valid, a is less than b
+ *
+ * Postconditions: The pair has been sent
+ *
+ * @param fd File descriptor to report the pair on
+ * @param a Smaller member of the pair
+ * @param b Larger member of the pair
+ */
+void send_amicable(int fd, uint64_t a, uint64_t b);
+
+/**
+ * @brief Sends the kernel counters to manage and clears them
+ *
+ * Preconditions: fd is valid
+ *
+ * Postconditions: The counters have been sent and reset
+ *
+ * @param fd File descriptor to send the counters on
+ */
+void send_stats(int fd);
+
+/**
+ * @brief Adds this thread's kernel counters to pool_stats and clears them
+ *
+ * Preconditions:
+ *
+ * Postconditions: kernel_stats is zero
+ */
+void merge_stats(void);
+
+/**
+ * @brief Sends a packet, keeping packets from other threads from interleaving
+ *
+ * Preconditions: fd is valid, p is not NULL
+ *
+ * Postconditions: The packet has been sent
+ *
+ * @param fd File descriptor to send on
+ * @param p Packet to send
+ */
+void send_locked(int fd, union packet *p);
+
+/**
+ * @brief Records a result in the table, then passes it on to table_forward
+ *
+ * Preconditions: table is attached, table_forward is set
+ *
+ * Postconditions: n has been recorded if it is perfect and reported
+ *
+ * @param fd File descriptor to report on
+ * @param n Number found
+ * @param exponent Mersenne exponent of n, 0 if not known
+ * @param k sigma(n) / n
+ */
+void table_report(int fd, uint64_t n, unsigned int exponent, unsigned int k);
+
+/**
+ * @brief Answers a batch of candidates from the table if it has all of them
+ *
+ * Preconditions: table is attached, n is not NULL, mask is not NULL
+ *
+ * Postconditions: mask has a bit set for each perfect number if the batch was
+ * answered
+ *
+ * @param n Candidates to look up
+ * @param count Number of candidates
+ * @param mask Pointer to load the perfect number mask into
+ * @return true if every candidate had been tested, false otherwise
+ */
+bool table_lookup(const uint64_t *n, unsigned int count, unsigned int *mask);
 
 /**
  * @brief Checks each number in assigned range, reporting when appropriate
@@ -131,7 +570,7 @@ bool shmem_report(struct shmem_res *res, int n);
  * @param start First number to test
  * @param end Last number to test
  */
-void pipe_loop(int start, int end);
+void pipe_loop(uint64_t start, uint64_t end);
 
 /**
  * @brief Reports perfect numbers over pipes.
@@ -140,9 +579,12 @@ void pipe_loop(int start, int end);
  *
  * Postconditions: n has been written to pipe
  *
- * @param n Number to report
+ * @param fd Write end of the pipe to manage
+ * @param n Number to report, 0 if it does not fit
+ * @param exponent Mersenne exponent of n, 0 if n was tested directly
+ * @param k sigma(n) / n, 2 for perfect numbers
  */
-void pipe_report(int n);
+void pipe_report(int fd, uint64_t n, unsigned int exponent, unsigned int k);
 
 /**
  * @brief Cleans up pipe resources
@@ -170,7 +612,9 @@ int sock_init(int argc, char **argv);
  * @brief Checks for perfect numbers
  *
  * Checks assigned range for perfect numbers, requesting a new range as
- * necessary.
+ * necessary. Up to prefetch ranges are asked for at once, so the next one is
+ * already waiting on the socket when a range is done instead of costing a
+ * round trip to the server.
  *
  * Preconditions: Sockets have been initialized
  *
@@ -188,9 +632,11 @@ void sock_loop(int fd);
  * Postconditions: The number has been sent to the managing server
  *
  * @param fd Socket file descriptor
- * @param n Number to report
+ * @param n Number to report, 0 if it does not fit
+ * @param exponent Mersenne exponent of n, 0 if n was tested directly
+ * @param k sigma(n) / n, 2 for perfect numbers
  */
-void sock_report(int fd, int n);
+void sock_report(int fd, uint64_t n, unsigned int exponent, unsigned int k);
 
 /**
  * @brief Cleans up socket resources
@@ -203,6 +649,39 @@ void sock_report(int fd, int n);
  */
 void sock_cleanup(int fd);
 
+/**
+ * @brief Classifies each candidate read from stdin
+ *
+ * Reads one number per line and prints it followed by perfect, abundant or
+ * deficient. Every candidate is factored with factor_sigma(), so spot checks
+ * of large numbers take microseconds each. A line holding anything but one
+ * positive decimal number and surrounding whitespace, or longer than
+ * VERIFY_LINE, is reported and skipped.
+ *
+ * Preconditions:
+ *
+ * Postconditions: Every line of stdin has been classified or a signal was
+ * caught
+ */
+void verify_loop(void);
+
+/**
+ * @brief Runs the aliquot sequence of each number in a range
+ *
+ * Every term's sum goes through the shared sigma cache, so sequences that
+ * merge, and other computes running sequences at the same time, reuse the
+ * terms already factored. Prints one record per sequence.
+ *
+ * Preconditions: start is positive, end is not less than start
+ *
+ * Postconditions: Every sequence has been run and printed, or a signal was
+ * caught
+ *
+ * @param start First starting term
+ * @param end Last starting term
+ */
+void aliquot_loop(uint64_t start, uint64_t end);
+
 /**
  * @brief Exits the program cleanly.
  *
@@ -226,6 +705,56 @@ void usage(void);
 /// Global variable to record caught signal so main loop can exit cleanly
 volatile sig_atomic_t exit_status = EXIT_SUCCESS;
 
+/// Kernel used to test candidates, selected with -k
+const struct kernel *kernel;
+
+/// Whether candidates are integers, Mersenne exponents, or k-perfect candidates
+enum search search = SEARCH_INTEGERS;
+
+/// Aliquot sums waiting to fill a packet when searching for amicable pairs,
+/// queued per thread
+__thread union packet aliquot;
+
+/// Candidates from here on are factored with rho, set with -r
+uint64_t rho_threshold = RHO_THRESHOLD_DEFAULT;
+
+/// Mask of enabled prefilter stages, set with -p and cleared with -s
+unsigned int prefilter = PREFILTER_DEFAULT;
+
+/// Ranges to hold at once in socket mode, set with -d
+int prefetch = PREFETCH_DEFAULT;
+
+/// Bits to trial factor Mersenne numbers to, set with -f; -1 lets
+/// mersenne_depth() pick for each exponent
+int factor_depth = -1;
+
+/// Tested and perfect numbers kept across runs, mapped with -T; addr is NULL
+/// when there is no table
+struct table_res table;
+
+/// Function table_report() passes results on to
+__thread report_fn table_forward;
+
+/// Number of threads testing candidates, set with -t; 0 until main() picks
+/// the CPUs in the affinity mask
+unsigned int nthreads = 0;
+
+/// Worker threads, only started when there is more than one thread
+struct pool pool;
+
+/// How threads are pinned to CPUs, set with -c
+struct affinity affinity;
+
+/// Keeps packets from threads sharing one pipe or socket from interleaving
+pthread_mutex_t send_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// Protects pool_stats, the gaps of the assignment being tested and the
+/// counters in this process's shared memory slot
+pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// Kernel counters merged from every thread, waiting for send_stats()
+struct kernel_stats pool_stats;
+
 /**
  * @brief Entry point for the program
  *
@@ -243,10 +772,102 @@ int main(int argc, char **argv) {
 	struct shmem_res res;
 	struct sigaction sigact;
 	char mode;
+	int opt;
 	int fd;
-	int start;
-	int end;
-	
+	uint64_t start;
+	uint64_t end;
+	enum isa isa = isa_detect();
+
+	kernel = kernel_find(KERNEL_DEFAULT);
+
+	// Options come before the mode; '+' stops at the first non-option
+	while ((opt = getopt(argc, argv, "+ac:d:ef:i:k:mp:r:st:T:")) != -1) {
+		switch (opt) {
+		case 'a':
+			search = SEARCH_AMICABLE;
+			break;
+		case 'c':
+			if (affinity_parse(optarg, &affinity) == false) {
+				fprintf(stderr, "Invalid CPU policy: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'd':
+			prefetch = atoi(optarg);
+			if ((prefetch <= 0) || (prefetch > PREFETCH_MAX)) {
+				fprintf(stderr, "Invalid prefetch depth: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'e':
+			search = SEARCH_EXPONENTS;
+			break;
+		case 'f':
+			factor_depth = atoi(optarg);
+			if ((factor_depth < 0) || (factor_depth > MERSENNE_DEPTH_MAX)) {
+				fprintf(stderr, "Invalid trial factoring depth: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'i':
+			if (isa_find(optarg, &isa) == false) {
+				fprintf(stderr, "Unknown instruction set: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'k':
+			kernel = kernel_find(optarg);
+			if (kernel == NULL) {
+				fprintf(stderr, "Unknown kernel: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'm':
+			search = SEARCH_MULTIPERFECT;
+			break;
+		case 'p':
+			if (prefilter_parse(optarg, &prefilter) == false) {
+				fprintf(stderr, "Unknown prefilter stage in: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 's':
+			// Test every candidate with the kernel, for validation runs
+			prefilter = 0;
+			break;
+		case 't':
+			if (atoi(optarg) <= 0) {
+				fprintf(stderr, "Invalid thread count: %s\n", optarg);
+				usage();
+			}
+			nthreads = atoi(optarg);
+			break;
+		case 'r':
+			rho_threshold = strtoull(optarg, NULL, 0);
+			if (rho_threshold == 0) {
+				fprintf(stderr, "Invalid rho threshold: %s\n", optarg);
+				usage();
+			}
+			break;
+		case 'T':
+			if (table_attach(&table, optarg, TABLE_LIMIT_DEFAULT) == false) {
+				exit(EXIT_FAILURE);
+			}
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	// Shift the options off so the positional indices still apply
+	argc -= optind - 1;
+	argv += optind - 1;
+
+	if (kernel_dispatch(isa) == false) {
+		exit(EXIT_FAILURE);
+	}
+
 	if (argc < ARGC_MIN) {
 		usage();
 	}
@@ -273,19 +894,42 @@ int main(int argc, char **argv) {
 
 	mode = argv[MODE_ARG][0]; // The first character is the mode
 
+	if (nthreads == 0) {
+		nthreads = (affinity.policy == AFFINITY_NONE) ? affinity_cpus() : affinity.ncpus;
+	}
+
+	// Shared memory computes start theirs once they know their slot, and
+	// verify and aliquot modes stay on this thread. Pipe and socket computes
+	// have no process list to find a slot in, so they start at slot 0, and
+	// manage hands each pipe compute its own CPU instead.
+	if ((mode == 'p') || (mode == 's')) {
+		if (start_threads(0, false) == false) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	switch (mode) {
 	case 'm':
 		if (shmem_load(&res) == false) {
 			exit(EXIT_FAILURE);
 		}
+		search = *res.search;
+		if (search == SEARCH_INTEGERS) {
+			// Manage already built the primes in shared memory
+			prime_attach(res.primes, *res.nprimes, *res.limit);
+			if ((kernel->init != NULL) && (kernel->init((*res.limit < rho_threshold) ?
+					*res.limit : rho_threshold - 1) == false)) {
+				exit(EXIT_FAILURE);
+			}
+		}
 		shmem_loop(&res);
 		break;
 	case 'p':
 		if (argc < PIPE_ARGC) {
 			usage();
 		}
-		start = atoi(argv[START_ARG]);
-		end = atoi(argv[END_ARG]);
+		start = strtoull(argv[START_ARG], NULL, 10);
+		end = strtoull(argv[END_ARG], NULL, 10);
 		pipe_loop(start, end);
 		pipe_cleanup();
 		break;
@@ -297,88 +941,277 @@ int main(int argc, char **argv) {
 		sock_loop(fd);
 		sock_cleanup(fd);
 		break;
+	case 'v':
+		verify_loop();
+		break;
+	case 'a':
+		if (argc < PIPE_ARGC) {
+			usage();
+		}
+		start = strtoull(argv[START_ARG], NULL, 10);
+		end = strtoull(argv[END_ARG], NULL, 10);
+		if ((start == 0) || (end < start)) {
+			usage();
+		}
+		aliquot_loop(start, end);
+		break;
 	default:
 		usage();
 		break;
 	}
 
+	if (pool.workers != NULL) {
+		pool_destroy(&pool);
+	}
+
 	exit(exit_status);
 }
 
-bool is_perfect_number(unsigned int n) {
-	unsigned int divisors[MAX_DIVISORS];
-	unsigned int n_divisors = 0;
-	unsigned int sum = 0;
-	unsigned int i;
-
-	for (i = 1; i < n; i++) {
-		if ((n % i) == 0) {
-			// Is a divisor
-			divisors[n_divisors++] = i;
+unsigned int next_batch(struct shmem_res *res, uint64_t *tests) {
+	unsigned int count = 0;
+	uint8_t *last;
+	uint8_t *addr;
+	int i;
+
+	assert(res != NULL);
+	assert(tests != NULL);
+
+	// Loop over each byte holding a number up to the limit. Manage marks the
+	// bits past the limit as tested, so they are never claimed.
+	last = res->bitmap + (*res->limit - 1) / 8;
+	for (addr = res->bitmap; addr <= last; addr++) {
+		if (*addr != 0xff) {
+
+			while (sem_wait(res->bitmap_sem) != 0) {
+				if ((errno == EDEADLK) || (errno == EINVAL)) {
+					perror("Could not lock semaphore");
+					return 0;
+				}
+
+				// Else we received EAGAIN or EINTR and should wait again
+			}
+
+			// Claim whatever the process that had the semaphore locked
+			// didn't claim
+			for (i = 0; i < 8; i++) {
+				if (BIT(*addr, i) == 0) {
+					SET_BIT(*addr, i);
+					tests[count++] = ((uint64_t)(addr - res->bitmap) * 8) + i + 1;
+				}
+			}
+
+			if (sem_post(res->bitmap_sem) == -1) {
+				perror("Could not unlock semaphore");
+				return 0;
+			}
+
+			if (count > 0) {
+				return count;
+			}
+
+			// Else another process claimed the rest of this byte first
+		}
+	}
+
+	return 0;
+}
+
+unsigned int test_batch(const uint64_t *n, unsigned int count) {
+	uint64_t kept[KERNEL_BATCH];
+	unsigned int index[KERNEL_BATCH];
+	unsigned int nkept = 0;
+	unsigned int found;
+	unsigned int mask = 0;
+	unsigned int i;
+
+	assert(n != NULL);
+	assert(count > 0);
+	assert(count <= KERNEL_BATCH);
+
+	if ((search == SEARCH_EXPONENTS) || (prefilter == 0)) {
+		return test_kernel(n, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (prefilter_pass(n[i], prefilter, kernel_stats.rejected) == true) {
+			index[nkept] = i;
+			kept[nkept++] = n[i];
 		}
 	}
 
-	for (i = 0; i < n_divisors; i++) {
-		sum += divisors[i];
+	if (nkept == 0) {
+		return 0;
 	}
 
-	return (sum == n);
+	// Map the survivors' bits back to their places in n
+	found = test_kernel(kept, nkept);
+	for (i = 0; i < nkept; i++) {
+		if ((found & (1U << i)) != 0) {
+			mask |= 1U << index[i];
+		}
+	}
+
+	return mask;
 }
 
-int next_test(struct shmem_res *res) {
-	int test;
-	uint8_t *addr;
-	int i;
+unsigned int test_multiperfect(const uint64_t *n, unsigned int count, unsigned int *k) {
+	unsigned __int128 sigma;
+	unsigned int mask = 0;
+	unsigned int i;
 
-	assert(res != NULL);
+	assert(n != NULL);
+	assert(k != NULL);
+	assert(count > 0);
+	assert(count <= KERNEL_BATCH);
+
+	for (i = 0; i < count; i++) {
+		sigma = factor_sigma(n[i]);
+		kernel_classify(n[i], sigma);
+		if ((sigma >= 2 * (unsigned __int128)n[i]) && (sigma % n[i] == 0)) {
+			k[i] = sigma / n[i];
+			mask |= 1U << i;
+		}
+	}
 
-	// Loop over each byte in the bitmap
-	// Will actually test until the end of the byte if manage was given a limit
-	// that was not a power of two
-	for (addr = res->bitmap; addr < (uint8_t *)res->perfect_numbers; addr++) {
-		for (i = 0; i < 8; i++) {
-			if (BIT(*addr, i) == 0) {
-
-				while (sem_wait(res->bitmap_sem) != 0) {
-					if ((errno == EDEADLK) || (errno == EINVAL)) {
-						perror("Could not lock semaphore");
-						return -1;
-					}
+	return mask;
+}
 
-					// Else we received EAGAIN or EINTR and should wait again
-				}
+unsigned int sieve_batch(const uint64_t *n, unsigned int count, unsigned int *k) {
+	uint64_t sums[KERNEL_BATCH];
+	unsigned int mask = 0;
+	unsigned int i;
+	uint64_t sum;
+
+	assert(n != NULL);
+	assert(k != NULL);
+	assert(count > 0);
+	assert(count <= KERNEL_BATCH);
+	assert(n[count - 1] - n[0] < KERNEL_BATCH);
+	assert(n[count - 1] < SIEVE_LIMIT);
+
+	kernel->sieve(sums, n[0], n[count - 1] - n[0] + 1);
+
+	for (i = 0; i < count; i++) {
+		sum = sums[n[i] - n[0]];
+		kernel_classify(n[i], sum);
+		if (sum == 2 * n[i]) {
+			k[i] = 2;
+			mask |= 1U << i;
+		} else if ((search == SEARCH_MULTIPERFECT) && (sum >= 3 * n[i]) &&
+				(sum % n[i] == 0)) {
+			k[i] = sum / n[i];
+			mask |= 1U << i;
+		}
+	}
 
-				// Check to make sure the process that had the semaphore
-				// locked didn't claim this number
-				if (BIT(*addr, i) == 0) {
-					// Claim this number for testing
-					SET_BIT(*addr, i);
+	return mask;
+}
 
-					test = ((addr - res->bitmap) * 8) + i + 1;
+unsigned int test_kernel(const uint64_t *n, unsigned int count) {
+	unsigned __int128 sigma;
+	unsigned int mask = 0;
+	unsigned int i;
 
-					if (sem_post(res->bitmap_sem) == -1) {
-						perror("Could not unlock semaphore");
-						return false;
-					}
+	assert(n != NULL);
+	assert(count > 0);
+	assert(count <= KERNEL_BATCH);
 
-					return test;
-				} else {
-					// Else unlock the semaphore and continue the loop
-					if (sem_post(res->bitmap_sem) == -1) {
-						perror("Could not unlock semaphore");
-						return false;
-					}
-				}
+	// The last candidate is the largest
+	if ((search == SEARCH_INTEGERS) && (kernel->batch != NULL) &&
+			(n[count - 1] < rho_threshold)) {
+		return kernel->batch(n, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (search == SEARCH_EXPONENTS) {
+			if (test_exponent(n[i]) == true) {
+				mask |= 1U << i;
 			}
+		} else if (n[i] >= rho_threshold) {
+			// Same test as rho_is_perfect(), keeping sigma to classify n
+			sigma = factor_sigma(n[i]);
+			kernel_classify(n[i], sigma);
+			if ((n[i] > 1) && (sigma == 2 * (unsigned __int128)n[i])) {
+				mask |= 1U << i;
+			}
+		} else if (kernel->test(n[i]) == true) {
+			mask |= 1U << i;
+		}
+	}
+
+	return mask;
+}
+
+bool start_threads(unsigned int slot, bool bind) {
+	int *cpus = NULL;
+	unsigned int i;
+	bool started;
+	int cpu;
+
+	assert(nthreads > 0);
+
+	if (nthreads == 1) {
+		// A failure has already been reported, and the thread can still run
+		// wherever the scheduler puts it
+		cpu = affinity_cpu(&affinity, slot);
+		if ((cpu >= 0) && (affinity_pin(cpu) == true) && (bind == true)) {
+			affinity_bind(affinity_node(cpu));
+		}
+		return true;
+	}
+
+	if (affinity.policy != AFFINITY_NONE) {
+		cpus = malloc(nthreads * sizeof(int));
+		if (cpus == NULL) {
+			perror("Could not allocate memory");
+			return false;
+		}
+
+		for (i = 0; i < nthreads; i++) {
+			cpus[i] = affinity_cpu(&affinity, slot + i);
 		}
 	}
 
-	return -1;
+	started = pool_init(&pool, nthreads, cpus, bind);
+	free(cpus);
+
+	return started;
+}
+
+bool test_exponent(uint64_t p) {
+	struct timespec started;
+	struct timespec finished;
+	unsigned int depth;
+	uint64_t factor;
+	bool found;
+
+	// Exponents past UINT_MAX are far beyond what Lucas-Lehmer can finish,
+	// so they are never reported
+	if (p > UINT_MAX) {
+		return false;
+	}
+
+	depth = (factor_depth < 0) ? mersenne_depth(p) : (unsigned int)factor_depth;
+	if (depth > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &started);
+		found = mersenne_trial_factor(p, depth, &factor);
+		clock_gettime(CLOCK_MONOTONIC, &finished);
+
+		kernel_stats.factor_ns += (int64_t)(finished.tv_sec - started.tv_sec) * 1000000000 +
+				(finished.tv_nsec - started.tv_nsec);
+		if (found == true) {
+			kernel_stats.factored++;
+			return false;
+		}
+	}
+
+	return mersenne_is_prime(p);
 }
 
 void shmem_loop(struct shmem_res *res) {
+	struct shmem_job job;
 	struct process *p;
-	int test;
+	unsigned int slot;
 	bool set = false;
 
 	assert(res != NULL);
@@ -388,6 +1221,20 @@ void shmem_loop(struct shmem_res *res) {
 			p->pid = getpid();
 			p->found = 0;
 			p->tested = 0;
+			p->abundant_exits = 0;
+			p->deficient_exits = 0;
+			p->full_scans = 0;
+			memset(p->rejected, 0, sizeof(p->rejected));
+			p->abundant = 0;
+			p->deficient = 0;
+			p->perfect = 0;
+			p->peak_n = 0;
+			p->peak_sigma = 0;
+			p->looked_up = 0;
+			p->factored = 0;
+			p->factor_ns = 0;
+			p->cpu = -1;
+			p->node = -1;
 
 			set = true;
 			break;
@@ -399,35 +1246,140 @@ void shmem_loop(struct shmem_res *res) {
 		return;
 	}
 
-	// Claim a new number until all have been tested
-	test = next_test(res);
-	while (test != -1) {
-		if (is_perfect_number(test) == true) {
-			p->found++;
-			if (shmem_report(res, test) == false) {
-				fprintf(stderr, "Could not report perfect number (%d)\n", test);
+	// Each compute takes the next nthreads slots of the policy, so computes
+	// started by hand on one host still land on different CPUs. Only the
+	// process list makes that possible: pipe and socket computes always
+	// start at slot 0.
+	slot = (p - res->processes) * nthreads;
+	if (start_threads(slot, true) == false) {
+		p->pid = -1;
+		exit_status = EXIT_FAILURE;
+		return;
+	}
+	p->cpu = affinity_cpu(&affinity, slot);
+	if (p->cpu >= 0) {
+		p->node = affinity_node(p->cpu);
+	}
+
+	if (pool.workers == NULL) {
+		shmem_work(res, p);
+	} else {
+		// Each worker starts with one number, leaving nothing to steal, and
+		// claims batches until none are left
+		job.res = res;
+		job.p = p;
+		pool_run(&pool, 1, pool.nthreads, 1, shmem_worker, &job);
+	}
+
+	// Remove self from process list
+	p->pid = -1;
+}
+
+void shmem_work(struct shmem_res *res, struct process *p) {
+	uint64_t tests[KERNEL_BATCH];
+	unsigned int k[KERNEL_BATCH];
+	unsigned int count;
+	unsigned int found;
+	unsigned int mask;
+	unsigned int i;
+
+	assert(res != NULL);
+	assert(p != NULL);
+
+	// Claim new numbers until all have been tested. When searching
+	// exponents the bitmap holds exponents, and so does the results list.
+	count = next_batch(res, tests);
+	while (count > 0) {
+		if ((search == SEARCH_INTEGERS) && (table.addr != NULL) &&
+				(table_lookup(tests, count, &mask) == true)) {
+			for (i = 0; i < count; i++) {
+				k[i] = 2;
+			}
+		} else if ((kernel->sieve != NULL) && (tests[count - 1] < SIEVE_LIMIT) &&
+				(tests[count - 1] < rho_threshold) && ((search == SEARCH_MULTIPERFECT) ||
+				((search == SEARCH_INTEGERS) &&
+				((prefilter & (1U << PREFILTER_EUCLID)) == 0)))) {
+			// A batch comes from one bitmap byte, so it spans at most eight
+			// numbers. Sieving them all is cheap, and classifies every
+			// number claimed, not just those past the prefilters.
+			mask = sieve_batch(tests, count, k);
+		} else if (search == SEARCH_MULTIPERFECT) {
+			mask = test_multiperfect(tests, count, k);
+		} else {
+			mask = test_batch(tests, count);
+			for (i = 0; i < count; i++) {
+				k[i] = 2;
 			}
 		}
 
-		p->tested++;
+		found = 0;
+		for (i = 0; i < count; i++) {
+			if ((mask & (1U << i)) != 0) {
+				found++;
+				if (shmem_report(res, tests[i], k[i]) == false) {
+					fprintf(stderr, "Could not report perfect number (%" PRIu64 ")\n",
+							tests[i]);
+				}
+			}
+		}
+
+		// Exponents are not integers, so they stay out of the table
+		if ((table.addr != NULL) && (search != SEARCH_EXPONENTS)) {
+			for (i = 0; i < count; i++) {
+				if (((mask & (1U << i)) != 0) && (k[i] == 2)) {
+					table_record(&table, tests[i]);
+				}
+				table_mark(&table, tests[i], tests[i]);
+			}
+		}
+
+		pthread_mutex_lock(&stats_lock);
+		p->found += found;
+		p->tested += count;
+
+		p->abundant_exits += kernel_stats.abundant_exits;
+		p->deficient_exits += kernel_stats.deficient_exits;
+		p->full_scans += kernel_stats.full_scans;
+		for (i = 0; i < PREFILTER_STAGES; i++) {
+			p->rejected[i] += kernel_stats.rejected[i];
+		}
+		p->abundant += kernel_stats.abundant;
+		p->deficient += kernel_stats.deficient;
+		p->perfect += kernel_stats.perfect;
+		kernel_peak(&p->peak_n, &p->peak_sigma, kernel_stats.peak_n,
+				kernel_stats.peak_sigma);
+		p->looked_up += kernel_stats.looked_up;
+		p->factored += kernel_stats.factored;
+		p->factor_ns += kernel_stats.factor_ns;
+		pthread_mutex_unlock(&stats_lock);
+		memset(&kernel_stats, 0, sizeof(kernel_stats));
 
 		// Check to see if a signal was caught
 		if (exit_status != EXIT_SUCCESS) {
 			fputs("\r", stderr);
 			break;
 		}
-		test = next_test(res);
+		count = next_batch(res, tests);
 	}
+}
 
-	// Remove self from process list
-	p->pid = -1;
+bool shmem_worker(uint64_t start, uint64_t end, void *arg) {
+	struct shmem_job *job = arg;
+
+	(void)start;
+	(void)end;
+	assert(job != NULL);
+
+	shmem_work(job->res, job->p);
+	return (exit_status == EXIT_SUCCESS);
 }
 
-bool shmem_report(struct shmem_res *res, int n) {
+bool shmem_report(struct shmem_res *res, uint64_t n, unsigned int k) {
 	int i;
 
 	assert(res != NULL);
 	assert(n > 0);
+	assert(k >= 2);
 
 	while (sem_wait(res->perfect_numbers_sem) != 0) {
 		if ((errno == EDEADLK) || (errno == EINVAL)) {
@@ -438,58 +1390,520 @@ bool shmem_report(struct shmem_res *res, int n) {
 		// Else we received EAGAIN or EINTR and should wait again
 	}
 
-	for (i = 0; i < NPERFNUMS; i++) {
-		if (res->perfect_numbers[i] == 0) {
-			// Open slot, use it
-			res->perfect_numbers[i] = n;
+	if (k == 2) {
+		for (i = 0; i < NPERFNUMS; i++) {
+			if (res->perfect_numbers[i] == 0) {
+				// Open slot, use it
+				res->perfect_numbers[i] = n;
 
-			if (sem_post(res->perfect_numbers_sem) == -1) {
-				perror("Could not unlock semaphore");
-				return false;
+				if (sem_post(res->perfect_numbers_sem) == -1) {
+					perror("Could not unlock semaphore");
+					return false;
+				}
+
+				return true;
 			}
+		}
+	} else {
+		for (i = 0; i < NMULTIPERFECT; i++) {
+			if (res->multiperfect[i].n == 0) {
+				res->multiperfect[i].n = n;
+				res->multiperfect[i].k = k;
+
+				if (sem_post(res->perfect_numbers_sem) == -1) {
+					perror("Could not unlock semaphore");
+					return false;
+				}
 
-			return true;
+				return true;
+			}
 		}
 	}
 
+	// List is full
+	if (sem_post(res->perfect_numbers_sem) == -1) {
+		perror("Could not unlock semaphore");
+	}
+
 	return false;
 }
 
-void pipe_loop(int start, int end) {
-	union packet p;
-	int i;
+bool test_range(int fd, uint64_t start, uint64_t end, report_fn report, uint64_t *stopped) {
+	uint64_t sums[SIEVE_SEGMENT];
+	uint64_t batch[KERNEL_BATCH];
+	unsigned int k[KERNEL_BATCH];
+	unsigned __int128 sigma;
+	unsigned int abundant = 0;
+	unsigned int deficient = 0;
+	uint64_t peak_floor = 0;
+	unsigned int mask;
+	unsigned int count;
+	unsigned int i;
+	uint64_t n;
+	uint64_t s;
 
 	assert(start > 0);
-	assert(end > start);
+	assert(end >= start);
+	assert(report != NULL);
+	assert(stopped != NULL);
+
+	// The loops test n - 1 < end rather than n <= end so that they also stop
+	// if n wraps past 2^64
+	if (search == SEARCH_EXPONENTS) {
+		for (n = start; n - 1 < end; n++) {
+			// Check to see if a signal was caught
+			if (exit_status != EXIT_SUCCESS) {
+				*stopped = n;
+				return false;
+			}
 
-	for (i = start; i <= end; i++) {
-		// Check to see if a signal was caught
+			if (test_exponent(n) == true) {
+				// test_exponent() only passes exponents up to UINT_MAX
+				report(fd, mersenne_perfect(n), (unsigned int)n, 2);
+			}
+		}
+
+		return true;
+	}
+
+	if (table.addr != NULL) {
+		// Only perfect numbers are recorded, so the other searches still
+		// have to test the range, but they can all add to the table
+		if ((search == SEARCH_INTEGERS) && (table_covers(&table, start, end) == true)) {
+			for (n = table_next_perfect(&table, start, end); n != 0;
+					n = table_next_perfect(&table, n + 1, end)) {
+				report(fd, n, 0, 2);
+			}
+			kernel_stats.looked_up += end - start + 1;
+			return true;
+		}
+
+		table_forward = report;
+		report = table_report;
+	}
+
+	// Rho covers everything from rho_threshold on, so the kernel doesn't
+	// need to
+	if ((kernel->init != NULL) &&
+			(kernel->init((end < rho_threshold) ? end : rho_threshold - 1) == false)) {
+		// Stop the main loops the same way a signal would
+		exit_status = EXIT_FAILURE;
+		*stopped = start;
+		return false;
+	}
+
+	if ((kernel->sieve == NULL) || (end >= SIEVE_LIMIT) || (end >= rho_threshold) ||
+			((search == SEARCH_INTEGERS) &&
+			((prefilter & (1U << PREFILTER_EUCLID)) != 0))) {
+		for (n = start; n - 1 < end; n += count) {
+			// Check to see if a signal was caught
+			if (exit_status != EXIT_SUCCESS) {
+				break;
+			}
+
+			count = KERNEL_BATCH;
+			if (end - n + 1 < count) {
+				count = end - n + 1;
+			}
+
+			if (search == SEARCH_AMICABLE) {
+				// No sums to look partners up in, so manage matches them all
+				for (i = 0; i < count; i++) {
+					sigma = factor_sigma(n + i);
+					kernel_classify(n + i, sigma);
+					if (sigma == 2 * (unsigned __int128)(n + i)) {
+						report(fd, n + i, 0, 2);
+					} else if (sigma - (n + i) <= UINT64_MAX) {
+						send_aliquot(fd, n + i, sigma - (n + i));
+					}
+				}
+				continue;
+			}
+
+			for (i = 0; i < count; i++) {
+				batch[i] = n + i;
+			}
+
+			if (search == SEARCH_MULTIPERFECT) {
+				mask = test_multiperfect(batch, count, k);
+			} else {
+				mask = test_batch(batch, count);
+				for (i = 0; i < count; i++) {
+					k[i] = 2;
+				}
+			}
+
+			for (i = 0; i < count; i++) {
+				if ((mask & (1U << i)) != 0) {
+					report(fd, n + i, 0, k[i]);
+				}
+			}
+		}
+
+		return finish_range(fd, start, n, end, stopped);
+	}
+
+	for (n = start; n - 1 < end; n += count) {
+		// A segment only takes a few milliseconds, so checking between
+		// segments is frequent enough
 		if (exit_status != EXIT_SUCCESS) {
-			p.id = PACKETID_CLOSED;
-			p.closed.pid = getpid();
-			send_packet(STDOUT_FILENO, &p);
 			break;
 		}
 
-		if (is_perfect_number(i) == true) {
-			pipe_report(i);
+		count = SIEVE_SEGMENT;
+		if (end - n + 1 < count) {
+			count = end - n + 1;
+		}
+
+		kernel->sieve(sums, n, count);
+
+		if (kernel_stats.peak_n != 0) {
+			peak_floor = kernel_stats.peak_sigma / kernel_stats.peak_n;
+		}
+
+		// Classify the segment while its sums are still in cache. Below
+		// SIEVE_LIMIT, sums[i] and 7n fit in 64 bits, so the counts are plain
+		// compares, and only a sum reaching the peak's whole abundancy times n
+		// needs the exact check. That is rare once the peak passes 3.
+		for (i = 0; i < count; i++) {
+			abundant += (sums[i] > 2 * (n + i));
+			deficient += (sums[i] < 2 * (n + i));
+
+			if (sums[i] >= peak_floor * (n + i)) {
+				kernel_peak(&kernel_stats.peak_n, &kernel_stats.peak_sigma, n + i,
+						sums[i]);
+				peak_floor = kernel_stats.peak_sigma / kernel_stats.peak_n;
+			}
+		}
+		kernel_stats.abundant += abundant;
+		kernel_stats.deficient += deficient;
+		kernel_stats.perfect += count - abundant - deficient;
+		abundant = 0;
+		deficient = 0;
+
+		for (i = 0; i < count; i++) {
+			if (sums[i] - (n + i) == n + i) {
+				report(fd, n + i, 0, 2);
+			} else if ((search == SEARCH_MULTIPERFECT) && (sums[i] >= 3 * (n + i)) &&
+					(sums[i] % (n + i) == 0)) {
+				// Below SIEVE_LIMIT sigma(n) stays under 8n, so neither the
+				// sum nor 3n can wrap
+				report(fd, n + i, 0, sums[i] / (n + i));
+			} else if (search == SEARCH_AMICABLE) {
+				s = sums[i] - (n + i);
+				if ((s > n + i) && (s - n < count)) {
+					// The partner is later in this segment
+					if (sums[s - n] - s == n + i) {
+						send_amicable(fd, n + i, s);
+					}
+				} else if ((s >= n) && (s < n + i)) {
+					// The partner was earlier in this segment and has already
+					// checked this number
+				} else {
+					send_aliquot(fd, n + i, s);
+				}
+			}
 		}
 	}
 
+	return finish_range(fd, start, n, end, stopped);
+}
+
+bool finish_range(int fd, uint64_t start, uint64_t n, uint64_t end, uint64_t *stopped) {
+	assert(stopped != NULL);
+
+	flush_aliquot(fd);
+
+	// Once the loop has run past end, n - 1 is at least end even if n wrapped
+	if (n - 1 >= end) {
+		if (table.addr != NULL) {
+			table_mark(&table, start, end);
+		}
+		return true;
+	}
+
+	if ((table.addr != NULL) && (n > start)) {
+		table_mark(&table, start, n - 1);
+	}
+	*stopped = n;
+
+	return false;
+}
+
+bool test_assignment(int fd, uint64_t start, uint64_t end, report_fn report) {
+	struct range_job job;
+	uint64_t stopped;
+	uint64_t grain;
+	bool tested;
+
+	assert(start > 0);
+	assert(end >= start);
+	assert(report != NULL);
+
+	job.fd = fd;
+	job.report = report;
+	job.start = start;
+	job.end = end;
+	job.gaps = NULL;
+	job.ngaps = 0;
+	job.size = 0;
+	job.lost = false;
+
+	if (pool.workers == NULL) {
+		tested = test_range(fd, start, end, report, &stopped);
+		if (tested == false) {
+			add_gap(&job, stopped, end);
+		}
+	} else if ((search != SEARCH_EXPONENTS) && (kernel->init != NULL) &&
+			(kernel->init((end < rho_threshold) ? end : rho_threshold - 1) == false)) {
+		// Exponents need no tables, and the pieces' own init calls are then
+		// no-ops
+		exit_status = EXIT_FAILURE;
+		tested = false;
+		add_gap(&job, start, end);
+	} else {
+		// A single exponent already takes a whole Lucas-Lehmer test
+		grain = (search == SEARCH_EXPONENTS) ? 1 : POOL_CHUNK;
+		tested = pool_run(&pool, start, end, grain, range_worker, &job);
+	}
+
+	if (tested == false) {
+		send_remainder(fd, &job);
+	}
+	free(job.gaps);
+
+	return tested;
+}
+
+bool range_worker(uint64_t start, uint64_t end, void *arg) {
+	struct range_job *job = arg;
+	uint64_t stopped;
+	bool tested;
+
+	assert(job != NULL);
+
+	tested = test_range(job->fd, start, end, job->report, &stopped);
+	merge_stats();
+
+	if (tested == false) {
+		pthread_mutex_lock(&stats_lock);
+		add_gap(job, stopped, end);
+		pthread_mutex_unlock(&stats_lock);
+	}
+
+	return tested;
+}
+
+void add_gap(struct range_job *job, uint64_t start, uint64_t end) {
+	struct gap *gaps;
+	unsigned int size;
+
+	assert(job != NULL);
+
+	if (job->ngaps == job->size) {
+		size = (job->size == 0) ? nthreads : job->size * 2;
+		gaps = realloc(job->gaps, size * sizeof(struct gap));
+		if (gaps == NULL) {
+			perror("Could not allocate memory");
+			job->lost = true;
+			return;
+		}
+		job->gaps = gaps;
+		job->size = size;
+	}
+
+	job->gaps[job->ngaps].start = start;
+	job->gaps[job->ngaps].end = end;
+	job->ngaps++;
+}
+
+void send_remainder(int fd, struct range_job *job) {
+	union packet p;
+	unsigned int i;
+
+	assert(job != NULL);
+
+	p.id = PACKETID_REMAINDER;
+	p.remainder.pid = getpid();
+
+	if (job->lost == true) {
+		// Testing some numbers twice is better than missing any
+		p.remainder.gap.start = job->start;
+		p.remainder.gap.end = job->end;
+		send_locked(fd, &p);
+		return;
+	}
+
+	qsort(job->gaps, job->ngaps, sizeof(struct gap), gap_compare);
+	for (i = 0; i < job->ngaps; i++) {
+		if ((i > 0) && (job->gaps[i].start == p.remainder.gap.end + 1)) {
+			p.remainder.gap.end = job->gaps[i].end;
+			continue;
+		}
+
+		if (i > 0) {
+			send_locked(fd, &p);
+		}
+		p.remainder.gap = job->gaps[i];
+	}
+
+	if (job->ngaps > 0) {
+		send_locked(fd, &p);
+	}
+}
+
+int gap_compare(const void *a, const void *b) {
+	const struct gap *x = a;
+	const struct gap *y = b;
+
+	assert(a != NULL);
+	assert(b != NULL);
+
+	return (x->start < y->start) ? -1 : (x->start > y->start);
+}
+
+void pipe_loop(uint64_t start, uint64_t end) {
+	union packet p;
+
+	assert(start > 0);
+	assert(end >= start);
+
+	if (test_assignment(STDOUT_FILENO, start, end, pipe_report) == false) {
+		send_stats(STDOUT_FILENO);
+		p.id = PACKETID_CLOSED;
+		p.closed.pid = getpid();
+		send_packet(STDOUT_FILENO, &p);
+	}
+
 	if (exit_status == EXIT_SUCCESS) {
+		send_stats(STDOUT_FILENO);
 		p.id = PACKETID_DONE;
 		p.done.pid = getpid();
 		send_packet(STDOUT_FILENO, &p);
 	}
 }
 
-void pipe_report(int n) {
+void pipe_report(int fd, uint64_t n, unsigned int exponent, unsigned int k) {
+	union packet p;
+
+	if (k == 2) {
+		p.id = PACKETID_PERFNUM;
+		p.perfnum.perfnum = n;
+		p.perfnum.exponent = exponent;
+	} else {
+		p.id = PACKETID_MULTIPERFECT;
+		p.multiperfect.n = n;
+		p.multiperfect.k = k;
+	}
+
+	send_locked(fd, &p);
+}
+
+void send_aliquot(int fd, uint64_t n, uint64_t s) {
+	unsigned int i;
+
+	assert(n > 0);
+	assert(s != n);
+
+	if ((s < 2) || ((s < n) && (s <= n / (ABUNDANCY_MAX - 1)))) {
+		return;
+	}
+
+	i = aliquot.aliquot.count++;
+	aliquot.aliquot.n[i] = n;
+	aliquot.aliquot.s[i] = s;
+
+	if (aliquot.aliquot.count == ALIQUOT_BATCH) {
+		flush_aliquot(fd);
+	}
+}
+
+void flush_aliquot(int fd) {
+	if (aliquot.aliquot.count == 0) {
+		return;
+	}
+
+	aliquot.id = PACKETID_ALIQUOT;
+	send_locked(fd, &aliquot);
+	aliquot.aliquot.count = 0;
+}
+
+void send_amicable(int fd, uint64_t a, uint64_t b) {
 	union packet p;
 
-	p.id = PACKETID_PERFNUM;
-	p.perfnum.perfnum = n;
+	assert(a < b);
 
-	send_packet(STDOUT_FILENO, &p);
+	p.id = PACKETID_AMICABLE;
+	p.amicable.a = a;
+	p.amicable.b = b;
+	send_locked(fd, &p);
+}
+
+void send_stats(int fd) {
+	union packet p;
+
+	// Workers merge theirs after each piece, so only this thread's are left
+	merge_stats();
+
+	p.id = PACKETID_STATS;
+	p.stats.pid = getpid();
+	pthread_mutex_lock(&stats_lock);
+	p.stats.stats = pool_stats;
+	memset(&pool_stats, 0, sizeof(pool_stats));
+	pthread_mutex_unlock(&stats_lock);
+
+	send_locked(fd, &p);
+}
+
+void merge_stats(void) {
+	pthread_mutex_lock(&stats_lock);
+	kernel_stats_add(&pool_stats, &kernel_stats);
+	pthread_mutex_unlock(&stats_lock);
+
+	memset(&kernel_stats, 0, sizeof(kernel_stats));
+}
+
+void send_locked(int fd, union packet *p) {
+	assert(p != NULL);
+
+	pthread_mutex_lock(&send_lock);
+	send_packet(fd, p);
+	pthread_mutex_unlock(&send_lock);
+}
+
+void table_report(int fd, uint64_t n, unsigned int exponent, unsigned int k) {
+	assert(table.addr != NULL);
+	assert(table_forward != NULL);
+
+	if (k == 2) {
+		table_record(&table, n);
+	}
+
+	table_forward(fd, n, exponent, k);
+}
+
+bool table_lookup(const uint64_t *n, unsigned int count, unsigned int *mask) {
+	unsigned int i;
+
+	assert(table.addr != NULL);
+	assert(n != NULL);
+	assert(mask != NULL);
+
+	for (i = 0; i < count; i++) {
+		if (table_covers(&table, n[i], n[i]) == false) {
+			return false;
+		}
+	}
+
+	*mask = 0;
+	for (i = 0; i < count; i++) {
+		if (table_next_perfect(&table, n[i], n[i]) != 0) {
+			*mask |= 1U << i;
+		}
+	}
+
+	kernel_stats.looked_up += count;
+	return true;
 }
 
 void pipe_cleanup(void) {
@@ -517,6 +1931,17 @@ void sock_loop(int fd) {
 	bool done = false;
 	int i;
 
+	// Ask for the first range and the ones to follow it. Each range done
+	// asks for another, keeping prefetch ranges in flight.
+	send_stats(fd);
+	p.id = PACKETID_DONE;
+	send_packet(fd, &p);
+
+	p.id = PACKETID_PREFETCH;
+	for (i = 1; i < prefetch; i++) {
+		send_packet(fd, &p);
+	}
+
 	while (done == false) {
 		// Check to see if a signal was caught
 		if (exit_status != EXIT_SUCCESS) {
@@ -524,9 +1949,6 @@ void sock_loop(int fd) {
 			break;
 		}
 
-		p.id = PACKETID_DONE;
-		send_packet(fd, &p);
-
 		get_packet(fd, &p);
 
 		switch (p.id) {
@@ -538,18 +1960,20 @@ void sock_loop(int fd) {
 			done = true;
 			break;
 		case PACKETID_RANGE:
-			for (i = p.range.start; i <= p.range.end; i++) {
-				// Check to see if a signal was caught
-				if (exit_status != EXIT_SUCCESS) {
-					fputs("\r", stderr);
-					p.id = PACKETID_CLOSED;
-					p.closed.pid = PID_CLIENT;
-					send_packet(fd, &p);
-					break;
-				}
-				if (is_perfect_number(i) == true) {
-					sock_report(fd, i);
-				}
+			search = p.range.search;
+			if (test_assignment(fd, p.range.start, p.range.end, sock_report) == false) {
+				fputs("\r", stderr);
+				send_stats(fd);
+				p.id = PACKETID_CLOSED;
+				p.closed.pid = PID_CLIENT;
+				send_packet(fd, &p);
+
+				// The server takes back the ranges still on their way
+				done = true;
+			} else {
+				send_stats(fd);
+				p.id = PACKETID_DONE;
+				send_packet(fd, &p);
 			}
 			break;
 		default:
@@ -558,27 +1982,184 @@ void sock_loop(int fd) {
 	}
 }
 
-void sock_report(int fd, int n) {
+void sock_report(int fd, uint64_t n, unsigned int exponent, unsigned int k) {
 	union packet p;
 
-	p.id = PACKETID_PERFNUM;
-	p.perfnum.perfnum = n;
+	if (k == 2) {
+		p.id = PACKETID_PERFNUM;
+		p.perfnum.perfnum = n;
+		p.perfnum.exponent = exponent;
+	} else {
+		p.id = PACKETID_MULTIPERFECT;
+		p.multiperfect.n = n;
+		p.multiperfect.k = k;
+	}
 
-	send_packet(fd, &p);
+	send_locked(fd, &p);
 }
 
 void sock_cleanup(int fd) {
 	close(fd);
 }
 
+void verify_loop(void) {
+	char line[VERIFY_LINE];
+	unsigned __int128 sigma;
+	uint64_t n;
+	char *start;
+	char *end;
+	int c;
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		// Check to see if a signal was caught
+		if (exit_status != EXIT_SUCCESS) {
+			break;
+		}
+
+		// Skip the rest of a line too long to hold one candidate, rather
+		// than reading it as another
+		if ((strchr(line, '\n') == NULL) && (feof(stdin) == 0)) {
+			fprintf(stderr, "Invalid candidate: %s...\n", line);
+			do {
+				c = getchar();
+			} while ((c != '\n') && (c != EOF));
+			continue;
+		}
+
+		// strtoull() would take a sign and negate the number, and stop at
+		// the first character that is not a digit
+		for (start = line; isspace((unsigned char)*start) != 0; start++);
+		errno = 0;
+		n = strtoull(start, &end, 10);
+		for (; isspace((unsigned char)*end) != 0; end++);
+		if ((isdigit((unsigned char)*start) == 0) || (*end != '\0') || (errno != 0) ||
+				(n == 0)) {
+			fprintf(stderr, "Invalid candidate: %s", line);
+			if (strchr(line, '\n') == NULL) {
+				fputc('\n', stderr);
+			}
+			continue;
+		}
+
+		sigma = factor_sigma(n);
+		if (sigma == 2 * (unsigned __int128)n) {
+			printf("%" PRIu64 " perfect\n", n);
+		} else if (sigma > 2 * (unsigned __int128)n) {
+			printf("%" PRIu64 " abundant\n", n);
+		} else {
+			printf("%" PRIu64 " deficient\n", n);
+		}
+	}
+}
+
+void aliquot_loop(uint64_t start, uint64_t end) {
+	struct aliquot_res res;
+	struct aliquot_record record;
+	uint64_t cached = 0;
+	uint64_t computed = 0;
+	uint64_t n;
+
+	assert(start > 0);
+	assert(end >= start);
+
+	if (aliquot_attach(&res) == false) {
+		exit_status = EXIT_FAILURE;
+		return;
+	}
+
+	for (n = start; n - 1 < end; n++) {
+		// Check to see if a signal was caught
+		if (exit_status != EXIT_SUCCESS) {
+			break;
+		}
+
+		aliquot_run(&res, n, ALIQUOT_STEPS, &record);
+		cached += record.cached;
+		computed += record.computed;
+
+		printf("%" PRIu64 ": ", n);
+		switch (record.end) {
+		case ALIQUOT_TERMINATES:
+			printf("terminates after %" PRIu64 " steps", record.steps);
+			break;
+		case ALIQUOT_CYCLE:
+			if (record.cycle == 1) {
+				printf("perfect");
+			} else if (record.cycle == 2) {
+				printf("amicable");
+			} else {
+				printf("sociable (%" PRIu64 ")", record.cycle);
+			}
+			printf(" cycle after %" PRIu64 " steps", record.steps);
+			break;
+		case ALIQUOT_OVERFLOW:
+			printf("passes 2^64 after %" PRIu64 " steps", record.steps);
+			break;
+		case ALIQUOT_OPEN:
+			printf("open after %" PRIu64 " steps", record.steps);
+			break;
+		}
+		printf(", peak %" PRIu64 ", %" PRIu64 " of %" PRIu64 " sums cached\n",
+				record.peak, record.cached, record.cached + record.computed);
+	}
+
+	fprintf(stderr, "Sigma cache: %" PRIu64 " hits, %" PRIu64 " misses\n", cached,
+			computed);
+
+	aliquot_detach(&res);
+}
+
 void handle_signal(int sig) {
 	exit_status = sig;
 }
 
 void usage(void) {
-	printf("Usage: compute ms <options>\n");
+	unsigned int i;
+
+	printf("Usage: compute [-a] [-e] [-f bits] [-i isa] [-k kernel] [-m] [-p stages] [-r threshold] [-s]\n");
+	printf("               [-c cpus] [-d depth] [-t threads] [-T file]\n");
+	printf("               amsv <options>\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("    -a:         also send aliquot sums for manage to pair up amicable\n");
+	printf("                numbers\n");
+	printf("    -c cpus:    pin threads to CPUs: compact fills one NUMA node first,\n");
+	printf("                scatter spreads over nodes, or list CPUs like 0-3,8;\n");
+	printf("                m mode gives each compute the next CPUs in the order\n");
+	printf("                and binds memory to each thread's node, but p and s\n");
+	printf("                modes always start from the first, so computes there\n");
+	printf("                sharing a host need separate lists\n");
+	printf("    -d depth:   ranges to hold at once in s mode, asking for the next\n");
+	printf("                while testing the current one (default %d, at most %d)\n",
+			PREFETCH_DEFAULT, PREFETCH_MAX);
+	printf("    -e:         test Mersenne exponents instead of integers\n");
+	printf("    -f bits:    trial factor 2^p - 1 up to 2^bits before the Lucas-Lehmer\n");
+	printf("                test, 0 to skip (default: deeper for larger p)\n");
+	printf("    -i isa:     instruction set for vector kernels (default: widest\n");
+	printf("                the CPU supports), one of: ");
+	isa_list();
+	printf("    -k kernel:  divisor-sum kernel to use (default %s)\n", KERNEL_DEFAULT);
+	printf("                one of: ");
+	kernel_list();
+	printf("    -m:         also find k-perfect numbers, sigma(n) = k * n for any\n");
+	printf("                k >= 3; needs a sieve kernel to run at full speed\n");
+	printf("    -p stages:  comma separated prefilter stages to enable, all or none\n");
+	printf("                (default all but euclid), each rejecting:\n");
+	for (i = 0; i < PREFILTER_STAGES; i++) {
+		printf("                %-8s%s\n", prefilter_name(i), prefilter_help(i));
+	}
+	printf("    -r threshold: factor candidates from threshold on with Pollard rho\n");
+	printf("                (default %" PRIu64 ")\n", (uint64_t)RHO_THRESHOLD_DEFAULT);
+	printf("    -s:         strict, test every candidate with the kernel\n");
+	printf("    -t threads: threads testing candidates in m, p and s modes (default:\n");
+	printf("                the CPUs this process may run on, or listed with -c)\n");
+	printf("    -T file:    answer numbers tested by earlier runs from a table kept\n");
+	printf("                in file, created if missing, and add new ones to it\n");
 	printf("\n");
 	printf("Modes:\n");
+	printf("    a - aliquot sequences, sharing a sigma cache with other computes\n");
+	printf("        usage: compute a <start> <end>\n");
+	printf("\n");
 	printf("    m - shared memory\n");
 	printf("        usage: compute m\n");
 	printf("\n");
@@ -587,6 +2168,9 @@ void usage(void) {
 	printf("\n");
 	printf("        address:    IP address of managing server\n");
 	printf("\n");
+	printf("    v - verify candidates read from stdin, one per line\n");
+	printf("        usage: compute v < <file>\n");
+	printf("\n");
 	printf("    Note:   The pipes mode can not be spawned directly.\n");
 	printf("            Use manage to start pipe mode.\n");
 	printf("\n");
@@ -2,16 +2,27 @@ EXE = compute
 
 SHELL = sh
 CC = gcc
+CXX = g++
 REMOVE = rm -f
 REMOVEDIR = rm -rf
 
 SRC =	compute.c \
+		affinity.c \
+		aliquot.c \
+		factor.c \
+		mersenne.c \
 		packets.c \
+		pool.c \
+		prefilter.c \
 		shmem.c \
+		sigma.c \
 		sock.c \
+		table.c \
+
+CXXSRC =	sigma_cxx.cpp \
 
 DEBUG = -ggdb
-OPTIMIZATION = 
+OPTIMIZATION = -O3
 INCLUDEDIRS = 
 OBJDIR = obj
 
@@ -22,18 +33,31 @@ CFLAGS =	$(INCLUDEDIRS) \
 			-Wmissing-declarations \
 			-Wstrict-prototypes \
 			-std=gnu99 \
+			-pthread \
+			$(OPTIMIZATION) \
+			$(DEBUG) \
+
+CXXFLAGS =	$(INCLUDEDIRS) \
+			-Wall \
+			-Wextra \
+			-std=c++17 \
+			-fno-exceptions \
+			-fno-rtti \
 			$(OPTIMIZATION) \
 			$(DEBUG) \
 
-LDFLAGS =	-lrt \
+LDFLAGS =	-lm \
+			-lrt \
+			-pthread \
 
 # Compiler flags to generate dependency files.
 GENDEPFLAGS = -MMD -MP -MF .dep/$(@F).d
 
 # Combine all necessary flags and optional flags.
 ALL_CFLAGS = $(CFLAGS) $(GENDEPFLAGS)
+ALL_CXXFLAGS = $(CXXFLAGS) $(GENDEPFLAGS)
 
-OBJ = $(SRC:%.c=$(OBJDIR)/%.o)
+OBJ = $(SRC:%.c=$(OBJDIR)/%.o) $(CXXSRC:%.cpp=$(OBJDIR)/%.o)
 
 all: $(EXE)
 
@@ -48,12 +72,18 @@ $(OBJDIR)/%.o : %.c
 	@echo Compiling: $<
 	$(CC) -c $(ALL_CFLAGS) $< -o $@ 
 
+# Compile: create object files from C++ source files.
+$(OBJDIR)/%.o : %.cpp
+	@echo Compiling: $<
+	$(CXX) -c $(ALL_CXXFLAGS) $< -o $@
+
 doc:
 	doxygen
 
 clean:
 	$(REMOVE) $(EXE)
 	$(REMOVE) $(SRC:%.c=$(OBJDIR)/%.o)
+	$(REMOVE) $(CXXSRC:%.cpp=$(OBJDIR)/%.o)
 	$(REMOVE) $(SRC:.c=.d)
 	$(REMOVEDIR) .dep
 	$(REMOVEDIR) $(OBJDIR)
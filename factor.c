@@ -0,0 +1,449 @@
+/**
+ * @file factor.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the Miller-Rabin and Pollard-Brent rho routines used to factor
+ * large candidates.
+ *
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "factor.h"
+
+/// Most prime factors, counted with multiplicity, a 64-bit number can have
+#define MAX_FACTORS 64
+
+/// Iterations of rho between gcds. Larger batches mean fewer gcds but more
+/// steps to redo when a batch overshoots.
+#define RHO_BATCH 128
+
+/// Primes divided out before rho. Anything left below the square of the last
+/// one is prime.
+static const uint32_t small_primes[] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71,
+	73, 79, 83, 89, 97
+};
+
+/// Number of entries in small_primes
+#define NSMALL_PRIMES (sizeof(small_primes) / sizeof(small_primes[0]))
+
+/// Miller-Rabin bases that are enough for every n below 2^64
+static const uint64_t witnesses[] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37
+};
+
+/// Number of entries in witnesses
+#define NWITNESSES (sizeof(witnesses) / sizeof(witnesses[0]))
+
+/**
+ * Constants for arithmetic modulo an odd n in Montgomery form, with R = 2^64
+ */
+struct montgomery {
+	uint64_t n;		///< Modulus
+	uint64_t inv;	///< n^-1 mod R
+	uint64_t one;	///< R mod n, which is 1 in Montgomery form
+	uint64_t r2;	///< R^2 mod n, used to convert into Montgomery form
+};
+
+/**
+ * @brief Computes the Montgomery constants for a modulus
+ *
+ * Preconditions: m is not NULL, n is odd
+ *
+ * Postconditions: m holds the constants for n
+ *
+ * @param m Constants to fill in
+ * @param n Modulus
+ */
+static void mont_init(struct montgomery *m, uint64_t n);
+
+/**
+ * @brief Divides by R modulo n
+ *
+ * Preconditions: m is not NULL, t is less than n * R
+ *
+ * Postconditions:
+ *
+ * @param m Montgomery constants
+ * @param t Number to reduce
+ * @return t / R mod n
+ */
+static uint64_t mont_reduce(const struct montgomery *m, unsigned __int128 t);
+
+/**
+ * @brief Multiplies two numbers in Montgomery form
+ *
+ * Preconditions: m is not NULL, a and b are less than n
+ *
+ * Postconditions:
+ *
+ * @param m Montgomery constants
+ * @param a First factor
+ * @param b Second factor
+ * @return a * b in Montgomery form
+ */
+static uint64_t mont_mul(const struct montgomery *m, uint64_t a, uint64_t b);
+
+/**
+ * @brief Converts a number into Montgomery form
+ *
+ * Preconditions: m is not NULL
+ *
+ * Postconditions:
+ *
+ * @param m Montgomery constants
+ * @param a Number to convert
+ * @return a * R mod n
+ */
+static uint64_t mont_from(const struct montgomery *m, uint64_t a);
+
+/**
+ * @brief Checks n against one Miller-Rabin base
+ *
+ * Preconditions: m is not NULL, n is odd and greater than the base, n - 1 is
+ * d * 2^s with d odd
+ *
+ * Postconditions:
+ *
+ * @param m Montgomery constants for n
+ * @param base Witness to try
+ * @param d Odd part of n - 1
+ * @param s Power of two in n - 1
+ * @return true if n is a strong probable prime to base, false otherwise
+ */
+static bool strong_probable_prime(const struct montgomery *m, uint64_t base,
+		uint64_t d, unsigned int s);
+
+/**
+ * @brief Finds a nontrivial factor of a composite number
+ *
+ * Uses Brent's cycle finding with the gcds of RHO_BATCH steps taken at once.
+ * A batch that overshoots is redone one step at a time, and a polynomial
+ * that only finds n itself is replaced with the next one.
+ *
+ * Preconditions: n is odd and composite
+ *
+ * Postconditions:
+ *
+ * @param n Number to split
+ * @return A factor of n other than 1 and n
+ */
+static uint64_t rho_split(uint64_t n);
+
+/**
+ * @brief Finds the prime factors of a number with no small factors
+ *
+ * Preconditions: factors is not NULL, count is not NULL, n is odd, factors has
+ * room for every prime factor of n
+ *
+ * Postconditions: The prime factors of n, with multiplicity and in no
+ * particular order, have been added to factors
+ *
+ * @param n Number to factor
+ * @param factors List to add the factors to
+ * @param count Number of factors in the list
+ */
+static void rho_factor(uint64_t n, uint64_t *factors, unsigned int *count);
+
+/**
+ * @brief Computes the greatest common divisor
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param a First number
+ * @param b Second number
+ * @return gcd(a, b)
+ */
+static uint64_t gcd(uint64_t a, uint64_t b);
+
+bool factor_is_prime(uint64_t n) {
+	struct montgomery m;
+	uint64_t d;
+	unsigned int s;
+	unsigned int i;
+
+	if (n < 2) {
+		return false;
+	}
+
+	for (i = 0; i < NSMALL_PRIMES; i++) {
+		if (n % small_primes[i] == 0) {
+			return (n == small_primes[i]);
+		}
+	}
+
+	// No factor up to the last small prime, so anything below its square is
+	// prime
+	if (n < (uint64_t)small_primes[NSMALL_PRIMES - 1] * small_primes[NSMALL_PRIMES - 1]) {
+		return true;
+	}
+
+	s = __builtin_ctzll(n - 1);
+	d = (n - 1) >> s;
+
+	mont_init(&m, n);
+
+	for (i = 0; i < NWITNESSES; i++) {
+		if (strong_probable_prime(&m, witnesses[i], d, s) == false) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+unsigned __int128 factor_sigma(uint64_t n) {
+	uint64_t factors[MAX_FACTORS];
+	unsigned __int128 sigma = 1;
+	unsigned __int128 term;
+	unsigned __int128 power;
+	unsigned int count = 0;
+	unsigned int i;
+	unsigned int j;
+	uint64_t p;
+
+	assert(n > 0);
+
+	for (i = 0; i < NSMALL_PRIMES; i++) {
+		p = small_primes[i];
+		if (n % p != 0) {
+			continue;
+		}
+
+		// sigma(p^k) = 1 + p + ... + p^k
+		term = 1;
+		power = 1;
+		do {
+			n /= p;
+			power *= p;
+			term += power;
+		} while (n % p == 0);
+
+		sigma *= term;
+	}
+
+	if (n > 1) {
+		rho_factor(n, factors, &count);
+	}
+
+	// Sort so that equal primes are next to each other. There are only a few.
+	for (i = 1; i < count; i++) {
+		p = factors[i];
+		for (j = i; (j > 0) && (factors[j - 1] > p); j--) {
+			factors[j] = factors[j - 1];
+		}
+		factors[j] = p;
+	}
+
+	for (i = 0; i < count; i = j) {
+		p = factors[i];
+		term = 1;
+		power = 1;
+		for (j = i; (j < count) && (factors[j] == p); j++) {
+			power *= p;
+			term += power;
+		}
+
+		sigma *= term;
+	}
+
+	return sigma;
+}
+
+bool rho_is_perfect(uint64_t n) {
+	if (n < 2) {
+		return false;
+	}
+
+	return (factor_sigma(n) == 2 * (unsigned __int128)n);
+}
+
+static void mont_init(struct montgomery *m, uint64_t n) {
+	uint64_t inv = n; // Correct to 3 bits, since n * n = 1 mod 8 for odd n
+	unsigned int i;
+
+	assert(m != NULL);
+	assert((n & 1) == 1);
+
+	// Each Newton step doubles the number of correct bits
+	for (i = 0; i < 5; i++) {
+		inv *= 2 - n * inv;
+	}
+
+	m->n = n;
+	m->inv = inv;
+	m->one = -n % n;
+	m->r2 = ((unsigned __int128)m->one * m->one) % n;
+}
+
+static uint64_t mont_reduce(const struct montgomery *m, unsigned __int128 t) {
+	// q * n matches t in the low word, so only the high words need subtracting
+	uint64_t q = (uint64_t)t * m->inv;
+	uint64_t high = (uint64_t)(((unsigned __int128)q * m->n) >> 64);
+	uint64_t top = (uint64_t)(t >> 64);
+
+	return (top >= high) ? (top - high) : (top - high + m->n);
+}
+
+static uint64_t mont_mul(const struct montgomery *m, uint64_t a, uint64_t b) {
+	return mont_reduce(m, (unsigned __int128)a * b);
+}
+
+static uint64_t mont_from(const struct montgomery *m, uint64_t a) {
+	return mont_mul(m, a % m->n, m->r2);
+}
+
+static bool strong_probable_prime(const struct montgomery *m, uint64_t base,
+		uint64_t d, unsigned int s) {
+	uint64_t minus_one = m->n - m->one;
+	uint64_t x = m->one;
+	uint64_t b = mont_from(m, base);
+	unsigned int i;
+
+	// x = base^d
+	for (; d > 0; d >>= 1) {
+		if ((d & 1) == 1) {
+			x = mont_mul(m, x, b);
+		}
+		b = mont_mul(m, b, b);
+	}
+
+	if ((x == m->one) || (x == minus_one)) {
+		return true;
+	}
+
+	for (i = 1; i < s; i++) {
+		x = mont_mul(m, x, x);
+		if (x == minus_one) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint64_t rho_split(uint64_t n) {
+	struct montgomery m;
+	uint64_t c;
+	uint64_t x;
+	uint64_t y;
+	uint64_t ys;
+	uint64_t q;
+	uint64_t g;
+	uint64_t r;
+	uint64_t k;
+	uint64_t i;
+
+	mont_init(&m, n);
+
+	// x -> x^2 + c, trying the next c if this one only finds n
+	for (c = m.one; ; c = (c + m.one >= n) ? c + m.one - n : c + m.one) {
+		y = mont_from(&m, 2);
+		ys = y;
+		q = m.one;
+		g = 1;
+		x = y;
+
+		for (r = 1; g == 1; r *= 2) {
+			x = y;
+			for (i = 0; i < r; i++) {
+				y = mont_mul(&m, y, y);
+				y = (y >= n - c) ? y - (n - c) : y + c;
+			}
+
+			for (k = 0; (k < r) && (g == 1); k += RHO_BATCH) {
+				ys = y;
+				for (i = 0; (i < RHO_BATCH) && (i < r - k); i++) {
+					y = mont_mul(&m, y, y);
+					y = (y >= n - c) ? y - (n - c) : y + c;
+					q = mont_mul(&m, q, (x > y) ? (x - y) : (y - x));
+				}
+
+				// R is odd relative to n, so Montgomery form keeps the gcd
+				g = gcd(q, n);
+			}
+		}
+
+		if (g == n) {
+			// The batch overshot; redo it one step at a time
+			do {
+				ys = mont_mul(&m, ys, ys);
+				ys = (ys >= n - c) ? ys - (n - c) : ys + c;
+				g = gcd((x > ys) ? (x - ys) : (ys - x), n);
+			} while (g == 1);
+		}
+
+		if (g != n) {
+			return g;
+		}
+	}
+}
+
+static void rho_factor(uint64_t n, uint64_t *factors, unsigned int *count) {
+	uint64_t d;
+
+	assert(factors != NULL);
+	assert(count != NULL);
+
+	if (n == 1) {
+		return;
+	}
+
+	if (factor_is_prime(n) == true) {
+		assert(*count < MAX_FACTORS);
+		factors[(*count)++] = n;
+		return;
+	}
+
+	d = rho_split(n);
+	rho_factor(d, factors, count);
+	rho_factor(n / d, factors, count);
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+	unsigned int shift;
+
+	if ((a == 0) || (b == 0)) {
+		return a | b;
+	}
+
+	shift = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+
+	do {
+		b >>= __builtin_ctzll(b);
+		if (a > b) {
+			uint64_t t = a;
+			a = b;
+			b = t;
+		}
+		b -= a;
+	} while (b != 0);
+
+	return a << shift;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file factor.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the Miller-Rabin and Pollard-Brent rho routines used to factor
+ * large candidates.
+ *
+ */
+#ifndef FACTOR_H
+#define FACTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Checks if an integer is prime
+ *
+ * Uses Miller-Rabin with the first twelve primes as bases, which has no
+ * false positives below 2^64. Arithmetic is done in Montgomery form so each
+ * step is a pair of 64-bit multiplies rather than a 128-bit division.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to test
+ * @return true if n is prime, false otherwise
+ */
+bool factor_is_prime(uint64_t n);
+
+/**
+ * @brief Computes sigma(n) by factoring n
+ *
+ * Small primes are divided out directly. What remains is split with
+ * Pollard-Brent rho until every factor passes factor_is_prime(). The cost
+ * grows with the fourth root of the second largest prime factor rather than
+ * the square root of n.
+ *
+ * Preconditions: n is positive
+ *
+ * Postconditions:
+ *
+ * @param n Number to compute sigma of
+ * @return Sum of all divisors of n, which may not fit in 64 bits
+ */
+unsigned __int128 factor_sigma(uint64_t n);
+
+/**
+ * @brief Checks if an integer is a perfect number by factoring it
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool rho_is_perfect(uint64_t n);
+
+#endif // FACTOR_H
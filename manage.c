@@ -39,8 +39,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h> // For PRIu64
 #include <limits.h> // For PIPE_BUF
-#include <math.h> // For floor()
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -48,8 +48,12 @@
 #include <stdlib.h>
 #include <string.h> // For memset()
 #include <unistd.h>
+#include "affinity.h"
+#include "amicable.h"
 #include "packets.h"
+#include "prefilter.h"
 #include "shmem.h"
+#include "sigma.h"
 #include "sock.h"
 
 /// Minimum number of arguments this program needs to run
@@ -64,7 +68,7 @@
 /// Number of arguments required for sockets method
 #define SOCK_ARGC 3
 
-/// Index of mode argument in argv
+/// Index of mode argument in argv
 #define MODE_ARG 1
 
 /// Index of limit argument in argv
@@ -85,14 +89,20 @@
 /// Maximum size of the PID string
 #define SPIDSTR 11
 
+/// Maximum size of a 64-bit number string
+#define SNUMSTR 21
+
 /// File mode of named pipe for pipe method
 #define FIFO_MODE (S_IRUSR | S_IWUSR)
 
 /// Number of tests to assign in each block
 #define NASSIGN 1000
 
-/// Size of the perfnums array in pipe_res
-#define SPERFNUMS 5
+/// Number of Mersenne exponents to assign in each block
+#define NASSIGN_EXPONENTS 64
+
+/// Size of the results arrays in pipe_res and sock_res
+#define SRESULTS 1024
 
 /// Maximum number of queued connections
 #define MAX_BACKLOG 32
@@ -111,12 +121,31 @@
  */
 struct pipe_res {
 	pid_t *compute_pids;		///< List of PIDs for compute processes
-	int perfnums[SPERFNUMS];	///< List of perfect numbers found
-	int nperfnums;				///< Number of perfect numbers found
+	union packet results[SRESULTS];	///< Perfect and k-perfect numbers found
+	int nresults;				///< Number of results found
 	int compute_pipe[2];		///< Pipe for communicating with compute processes
 	int report_fifo;			///< FIFO for communicating with report process
 	int nprocs;					///< Number of compute processes spawned
-	int limit;					///< Highest number to test
+	uint64_t limit;				///< Highest number to test
+	enum search search;			///< Whether limit counts integers or exponents
+	struct kernel_stats stats;	///< Kernel counters summed over all computes
+	struct amicable_join amicable;	///< Aliquot sums waiting for their partner's
+	const char *table;			///< Table file passed to each compute, NULL for none
+	const char *stages;			///< Prefilter stages passed to each compute, NULL for its default
+	int threads;				///< Threads each compute runs
+	const struct affinity *affinity;	///< Policy the computes are pinned with, NULL for none
+};
+
+/**
+ * Ranges held by one socket client, oldest first. A client tests its ranges in
+ * the order they were sent, and may ask for more before the first is done.
+ */
+struct client_ranges {
+	struct gap ranges[PREFETCH_MAX];	///< Ranges sent to the client, a ring starting at first
+	unsigned int first;			///< Index of the range the client is testing
+	unsigned int count;			///< Number of ranges the client holds
+	unsigned int waiting;		///< Ranges the client asked for while none were free
+	bool drained;				///< Client returned what it did not test of its first range
 };
 
 /**
@@ -126,15 +155,23 @@ struct sock_res {
 	int listen;					///< File descriptor of server socket
 	int notify;					///< File descriptor of client receiving notifications
 	int clients[MAX_CLIENTS];	///< List of connected clients
-	int perfnums[SPERFNUMS];	///< List of perfect numbers found
-	int nperfnums;				///< Number of perfect numbers found
-	int limit;					///< Highest number to test
-	int highest_assigned;		///< Highest number assigned to a compute process
+	union packet results[SRESULTS];	///< Perfect and k-perfect numbers found
+	int nresults;				///< Number of results found
+	uint64_t limit;				///< Highest number to test
+	enum search search;			///< Whether limit counts integers or exponents
+	struct kernel_stats stats;	///< Kernel counters summed over all computes
+	struct amicable_join amicable;	///< Aliquot sums waiting for their partner's
+	uint64_t highest_assigned;	///< Highest number assigned to a compute process
 	bool done;					///< Flag to mark whether computation has finished
 	fd_set allfds;				///< Set of all file descriptors to listen on
 	int maxfd;					///< Highest file descriptor to listen on
 	int maxi;					///< Highest assigned index in clients
 	bool missed_some;			///< Flag to mark if a process terminated prematurely
+	struct client_ranges held[FD_SETSIZE];	///< Ranges held by each client socket
+	unsigned int outstanding;	///< Number of ranges held by all clients
+	struct gap *gaps;			///< Ranges returned untested, waiting to be assigned again
+	unsigned int ngaps;			///< Number of ranges in gaps
+	unsigned int gaps_size;		///< Number of ranges gaps has room for
 };
 
 /**
@@ -146,10 +183,16 @@ struct sock_res {
  *
  * @param argc Number of arguments in argv
  * @param argv List of arguments given to the program
+ * @param search Whether the limit counts integers or Mersenne exponents
+ * @param table Table file for the computes to share, NULL for none
+ * @param stages Prefilter stages for the computes to enable, NULL for their
+ * default
+ * @param affinity Policy to pin the computes with, NULL to leave them unpinned
  * @param res Pointer to a pipe resource structure
  * @return true on success, false otherwise
  */
-bool pipe_init(int argc, char **argv, struct pipe_res *res);
+bool pipe_init(int argc, char **argv, enum search search, const char *table,
+		const char *stages, const struct affinity *affinity, struct pipe_res *res);
 
 /**
  * @brief Reports perfect numbers found
@@ -185,10 +228,11 @@ void pipe_cleanup(struct pipe_res *res);
  *
  * @param argc Number of arguments in argv
  * @param argv List of arguments given to the program
+ * @param search Whether the limit counts integers or Mersenne exponents
  * @param res Pointer to a shared memory resource structure
  * @return true on success, false otherwise
  */
-bool shmem_init(int argc, char **argv, struct shmem_res *res);
+bool shmem_init(int argc, char **argv, enum search search, struct shmem_res *res);
 
 /**
  * @brief Cleans up shared memory resources
@@ -212,10 +256,11 @@ void shmem_cleanup(struct shmem_res *res);
  *
  * @param argc Number of arguments in argv
  * @param argv List of arguments given to the program
+ * @param search Whether the limit counts integers or Mersenne exponents
  * @param res Pointer to a socket resource structure
  * @return true on success, false otherwise
  */
-bool sock_init(int argc, char **argv, struct sock_res *res);
+bool sock_init(int argc, char **argv, enum search search, struct sock_res *res);
 
 /**
  * @brief Reports perfect numbers found
@@ -257,6 +302,110 @@ void sock_cleanup(struct sock_res *res);
  */
 bool sock_handle_packet(int fd, struct sock_res *res, union packet *p);
 
+/**
+ * @brief Queues a range a client returned untested to be assigned again
+ *
+ * Preconditions: res is not NULL, start is not greater than end
+ *
+ * Postconditions: The range has been queued, or reported as missed if there
+ * was no room
+ *
+ * @param res Pointer to socket resource structure
+ * @param start First number of the range
+ * @param end Last number of the range
+ */
+void queue_gap(struct sock_res *res, uint64_t start, uint64_t end);
+
+/**
+ * @brief Assigns a client the next range to test
+ *
+ * Ranges returned untested go out again first, at most a block at a time,
+ * then the numbers past highest_assigned.
+ *
+ * Preconditions: res is not NULL, fd is a connected client holding fewer than
+ * PREFETCH_MAX ranges
+ *
+ * Postconditions: A range has been sent and recorded as the client's, if any
+ * was left
+ *
+ * @param res Pointer to socket resource structure
+ * @param fd Socket of the client
+ * @return true if a range was assigned, false if none was left
+ */
+bool assign_range(struct sock_res *res, int fd);
+
+/**
+ * @brief Ends a client's oldest range, putting it back in the queue if asked to
+ *
+ * Preconditions: res is not NULL, fd is a valid client socket
+ *
+ * Postconditions: The client no longer holds the range it was testing
+ *
+ * @param res Pointer to socket resource structure
+ * @param fd Socket of the client
+ * @param requeue Whether the range has to be tested again
+ */
+void release_range(struct sock_res *res, int fd, bool requeue);
+
+/**
+ * @brief Takes back every range a client holds once it stops
+ *
+ * The range it was testing is queued again unless the client already
+ * returned what it left of it. Ranges it asked for ahead of time were never
+ * started, so they are always queued again.
+ *
+ * Preconditions: res is not NULL, fd is a valid client socket
+ *
+ * Postconditions: The client holds no ranges and is not waiting for any
+ *
+ * @param res Pointer to socket resource structure
+ * @param fd Socket of the client
+ */
+void release_client(struct sock_res *res, int fd);
+
+/**
+ * @brief Records that a client asked for another range
+ *
+ * A client asking for more than PREFETCH_MAX ranges at once is ignored past
+ * that.
+ *
+ * Preconditions: res is not NULL, fd is a valid client socket
+ *
+ * Postconditions: The request waits for sock_settle()
+ *
+ * @param res Pointer to socket resource structure
+ * @param fd Socket of the client
+ */
+void request_range(struct sock_res *res, int fd);
+
+/**
+ * @brief Hands ranges to waiting clients and finishes once all are tested
+ *
+ * Computation only counts as complete once every range has been tested, not
+ * when the last one is handed out, so a range returned by a compute that
+ * stopped early can still go to a client that is waiting. Once complete,
+ * waiting clients are refused and report gets the totals.
+ *
+ * Preconditions: res is not NULL
+ *
+ * Postconditions: Every waiting client has a range, or computation is
+ * complete, or some client is still testing one
+ *
+ * @param res Pointer to socket resource structure
+ */
+void sock_settle(struct sock_res *res);
+
+/**
+ * @brief Tells report that numbers may have been missed
+ *
+ * Preconditions: res is not NULL
+ *
+ * Postconditions: missed_some has been set and report notified
+ *
+ * @param res Pointer to socket resource structure
+ */
+void sock_missed(struct sock_res *res);
+
 /**
  * @brief Spawns compute processes for the pipes method
  *
@@ -271,9 +420,100 @@ bool sock_handle_packet(int fd, struct sock_res *res, union packet *p);
  * @param fds Pointer to two file descriptors for pipe
  * @param limit Highest number to test
  * @param nprocs Number of processes to spawn
+ * @param search Whether the limit counts integers or Mersenne exponents
+ * @param table Table file passed to each compute with -T, NULL for none
+ * @param stages Prefilter stages passed to each compute with -p, NULL for
+ * its default
+ * @param threads Threads each compute runs, passed with -t
+ * @param affinity Policy compute i is pinned with as slot i, NULL to leave
+ * them unpinned
  * @return -1 on error, 0 on success
  */
-int spawn_computes(pid_t **pids, int fds[2], int limit, int nprocs);
+int spawn_computes(pid_t **pids, int fds[2], uint64_t limit, int nprocs,
+		enum search search, const char *table, const char *stages, int threads,
+		const struct affinity *affinity);
+
+/**
+ * @brief Spawns one compute process testing a range over the compute pipe
+ *
+ * Preconditions: fds is the compute pipe
+ *
+ * Postconditions: The process has been spawned
+ *
+ * @param fds Pointer to two file descriptors for pipe
+ * @param start First number to test
+ * @param end Last number to test
+ * @param search Whether the range holds integers or Mersenne exponents
+ * @param table Table file passed to the compute with -T, NULL for none
+ * @param stages Prefilter stages passed to the compute with -p, NULL for its
+ * default
+ * @param threads Threads the compute runs, passed with -t
+ * @param cpu CPU to pin the compute to, -1 to leave it unpinned
+ * @return PID of the compute, -1 on error
+ */
+pid_t spawn_compute(int fds[2], uint64_t start, uint64_t end, enum search search,
+		const char *table, const char *stages, int threads, int cpu);
+
+/**
+ * @brief Spawns a compute to test what a stopping compute left untested
+ *
+ * The new compute is pinned like the one it replaces and counted with the
+ * others, so pipe_report() waits for it too.
+ *
+ * Preconditions: res is not NULL, remainder is not NULL
+ *
+ * Postconditions: A compute testing the remainder has been spawned
+ *
+ * @param res Pointer to pipe resource structure
+ * @param remainder Range the stopping compute did not test
+ * @return true on success, false otherwise
+ */
+bool respawn_compute(struct pipe_res *res, struct packet_remainder *remainder);
+
+/**
+ * @brief Records a perfect or k-perfect number in a list of found numbers
+ *
+ * The whole packet is kept so it can be sent on again as it was received.
+ *
+ * Preconditions: results is not NULL, nresults is not NULL, result is not NULL
+ *
+ * Postconditions: The number has been added to the list, or an error has been
+ * reported if the list is full
+ *
+ * @param results List of numbers found
+ * @param nresults Pointer to the number of numbers found
+ * @param result The perfnum or multiperfect packet to record
+ */
+void save_result(union packet *results, int *nresults, union packet *result);
+
+/**
+ * @brief Passes a result on to report and records it
+ *
+ * Preconditions: res is not NULL, packet is not NULL
+ *
+ * Postconditions: The result has been recorded and sent to report
+ *
+ * @param res Pointer to pipe resource structure
+ * @param packet The perfnum, multiperfect or amicable packet to pass on
+ * @return false if report has disconnected, true otherwise
+ */
+bool pipe_forward(struct pipe_res *res, union packet *packet);
+
+/**
+ * @brief Matches a packet of aliquot sums against the sums already received
+ *
+ * Preconditions: join has been initialized, aliquot is not NULL, pairs has
+ * room for ALIQUOT_BATCH packets
+ *
+ * Postconditions: Each sum has been matched, stored or dropped
+ *
+ * @param join Table of sums waiting for their partner's
+ * @param aliquot Sums to match
+ * @param pairs Array to load an amicable packet into for each pair confirmed
+ * @return Number of pairs confirmed
+ */
+unsigned int match_aliquot(struct amicable_join *join, struct packet_aliquot *aliquot,
+		union packet *pairs);
 
 /**
  * @brief Kills and reaps any remaining compute processes
@@ -302,7 +542,7 @@ void collect_computes(struct pipe_res *res);
  * @param object_size Size of the shared memory object to create
  * @return Pointer to the mmaped shared memory object
  */
-void *shmem_mount(char *path, int object_size);
+void *shmem_mount(char *path, size_t object_size);
 
 /**
  * @brief Accepts a new TCP connection if there is room for more clients
@@ -359,7 +599,58 @@ int main(int argc, char **argv) {
 	struct pipe_res pipe_res;
 	struct shmem_res shmem_res;
 	struct sock_res sock_res;
+	struct affinity affinity;
+	enum search search = SEARCH_INTEGERS;
+	const char *table = NULL;
+	const char *stages = NULL;
+	unsigned int mask;
+	bool pinned = false;
 	char mode;
+	int opt;
+
+	// Options come before the mode; '+' stops at the first non-option
+	while ((opt = getopt(argc, argv, "+ac:emp:sT:")) != -1) {
+		switch (opt) {
+		case 'e':
+			search = SEARCH_EXPONENTS;
+			break;
+		case 'a':
+			search = SEARCH_AMICABLE;
+			break;
+		case 'c':
+			if (affinity_parse(optarg, &affinity) == false) {
+				fprintf(stderr, "Invalid CPU policy: %s\n", optarg);
+				usage();
+			}
+			pinned = true;
+			break;
+		case 'm':
+			search = SEARCH_MULTIPERFECT;
+			break;
+		case 'p':
+			// Checked here so that a typo stops manage, not each compute
+			if (prefilter_parse(optarg, &mask) == false) {
+				fprintf(stderr, "Unknown prefilter stage in: %s\n", optarg);
+				usage();
+			}
+			stages = optarg;
+			break;
+		case 's':
+			// Compute's -s is the same as enabling no stage
+			stages = "none";
+			break;
+		case 'T':
+			table = optarg;
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	// Shift the options off so the positional indices still apply
+	argc -= optind - 1;
+	argv += optind - 1;
 
 	if (argc < ARGC_MIN) {
 		usage();
@@ -390,7 +681,8 @@ int main(int argc, char **argv) {
 	switch (mode) {
 	case 'p':
 		// Pipe stuff
-		if (pipe_init(argc, argv, &pipe_res) == false) {
+		if (pipe_init(argc, argv, search, table, stages,
+				(pinned == true) ? &affinity : NULL, &pipe_res) == false) {
 			collect_computes(&pipe_res);
 			exit(EXIT_FAILURE);
 		}
@@ -399,7 +691,7 @@ int main(int argc, char **argv) {
 		break;
 	case 'm':
 		// Shmem stuff
-		if (shmem_init(argc, argv, &shmem_res) == false) {
+		if (shmem_init(argc, argv, search, &shmem_res) == false) {
 			exit(EXIT_FAILURE);
 		}
 		while (1) {
@@ -413,7 +705,7 @@ int main(int argc, char **argv) {
 		break;
 	case 's':
 		// Socket stuff
-		if (sock_init(argc, argv, &sock_res) == false) {
+		if (sock_init(argc, argv, search, &sock_res) == false) {
 			exit(EXIT_FAILURE);
 		}
 		sock_report(&sock_res);
@@ -427,7 +719,8 @@ int main(int argc, char **argv) {
 	exit(EXIT_SUCCESS);
 }
 
-bool pipe_init(int argc, char **argv, struct pipe_res *res) {
+bool pipe_init(int argc, char **argv, enum search search, const char *table,
+		const char *stages, const struct affinity *affinity, struct pipe_res *res) {
 	char pid_str[SPIDSTR];
 	int fd;
 
@@ -437,15 +730,40 @@ bool pipe_init(int argc, char **argv, struct pipe_res *res) {
 		usage();
 	}
 
-	res->nperfnums = 0;
-	res->limit = atoi(argv[2]);
+	res->nresults = 0;
+	memset(&res->stats, 0, sizeof(res->stats));
+	res->limit = strtoull(argv[2], NULL, 10);
 	res->nprocs = atoi(argv[3]);
+	res->search = search;
+	res->amicable.keys = NULL;
+	res->amicable.values = NULL;
+	res->table = table;
+	res->stages = stages;
+	res->affinity = affinity;
+
+	// Left to itself each compute would run a thread on every CPU. A pinned
+	// compute has one CPU, and the others share the CPUs between them.
+	res->threads = 1;
+	if ((affinity == NULL) && (res->nprocs > 0) &&
+			(affinity_cpus() / res->nprocs > 1)) {
+		res->threads = affinity_cpus() / res->nprocs;
+	}
 
 	if (spawn_computes(
 			&res->compute_pids,
 			res->compute_pipe,
 			res->limit,
-			res->nprocs) == -1) {
+			res->nprocs,
+			res->search,
+			table,
+			stages,
+			res->threads,
+			affinity) == -1) {
+		return false;
+	}
+
+	if ((search == SEARCH_AMICABLE) &&
+			(amicable_init(&res->amicable, res->limit) == false)) {
 		return false;
 	}
 
@@ -487,6 +805,9 @@ bool pipe_init(int argc, char **argv, struct pipe_res *res) {
 
 void pipe_report(struct pipe_res *res) {
 	union packet packet;
+	union packet pairs[ALIQUOT_BATCH];
+	unsigned int npairs;
+	unsigned int j;
 	int bytes_read;
 	int body_count = 0;
 	bool done = false;
@@ -516,20 +837,33 @@ void pipe_report(struct pipe_res *res) {
 		if (bytes_read > 0) {
 			switch (packet.id) {
 			case PACKETID_PERFNUM:
-				res->perfnums[res->nperfnums++] = packet.perfnum.perfnum;
-				if (send_packet(res->report_fifo, &packet) == -1) {
-					if (errno != EPIPE) {
-						perror("Could not send packet");
-					} else {
-						fprintf(stderr, "Reporting process disconnected\n");
+			case PACKETID_MULTIPERFECT:
+			case PACKETID_AMICABLE:
+				if (pipe_forward(res, &packet) == false) {
+					done = true;
+				}
+				break;
+			case PACKETID_ALIQUOT:
+				npairs = match_aliquot(&res->amicable, &packet.aliquot, pairs);
+				for (j = 0; j < npairs; j++) {
+					if (pipe_forward(res, &pairs[j]) == false) {
 						done = true;
 					}
 				}
 				break;
+			case PACKETID_STATS:
+				kernel_stats_add(&res->stats, &packet.stats.stats);
+				break;
+			case PACKETID_REMAINDER:
+				if (respawn_compute(res, &packet.remainder) == false) {
+					// Inform report
+					packet.id = PACKETID_CLOSED;
+					packet.closed.pid = packet.remainder.pid;
+					send_packet(res->report_fifo, &packet);
+				}
+				break;
 			case PACKETID_CLOSED:
-				// Inform report
-				send_packet(res->report_fifo, &packet);
-				// No break
+				// The remainder packets before it already said what is left
 			case PACKETID_DONE:
 				if (waitpid(packet.done.pid, NULL, 0) == -1) {
 					perror("Could not collect process");
@@ -566,6 +900,12 @@ void pipe_cleanup(struct pipe_res *res) {
 
 	assert(res != NULL);
 
+	// Pass the totals on before saying whether computation finished
+	packet.id = PACKETID_STATS;
+	packet.stats.pid = getpid();
+	packet.stats.stats = res->stats;
+	send_packet(res->report_fifo, &packet);
+
 	if (exit_status == EXIT_SUCCESS) {
 		// Inform report that computation is finished
 		packet.id = PACKETID_DONE;
@@ -587,6 +927,10 @@ void pipe_cleanup(struct pipe_res *res) {
 		perror("Could not close pipe");
 	}
 
+	if (close(res->compute_pipe[WRITE]) == -1) {
+		perror("Could not close pipe");
+	}
+
 	if (close(res->report_fifo) == -1) {
 		perror("Could not close FIFO");
 	}
@@ -608,17 +952,16 @@ void pipe_cleanup(struct pipe_res *res) {
 	}
 
 	free(res->compute_pids);
+	amicable_free(&res->amicable);
 
 	unlink(PID_FILE);
 }
 
-bool shmem_init(int argc, char **argv, struct shmem_res *res) {
+bool shmem_init(int argc, char **argv, enum search search, struct shmem_res *res) {
 	struct process *p;
-	int total_size;
-	int bitmap_size;
-	int perfnums_size;
-	int processes_size;
-	int limit;
+	uint32_t *primes = NULL;
+	uint64_t nprimes = 0;
+	uint64_t limit;
 
 	assert(res != NULL);
 
@@ -626,13 +969,21 @@ bool shmem_init(int argc, char **argv, struct shmem_res *res) {
 		usage();
 	}
 
-	limit = atoi(argv[2]);
+	if (search == SEARCH_AMICABLE) {
+		// Computes in this mode have no channel to send their sums on
+		fprintf(stderr, "Amicable pairs need pipe or socket mode\n");
+		return false;
+	}
 
-	bitmap_size = limit / 8 + 1;
-	perfnums_size = NPERFNUMS * sizeof(int);
-	processes_size = NPROCS * sizeof(struct process);
-	total_size = sizeof(pid_t) + sizeof(int) + (2 * sizeof(sem_t)) +
-	   bitmap_size + perfnums_size + processes_size;
+	limit = strtoull(argv[2], NULL, 10);
+
+	// Build the prime table once here rather than once in every compute
+	if (search == SEARCH_INTEGERS) {
+		primes = prime_build(limit, &nprimes);
+		if (primes == NULL) {
+			return false;
+		}
+	}
 
 	if (shm_unlink(SHMEM_PATH) == -1) {
 		if (errno != ENOENT) {
@@ -641,22 +992,26 @@ bool shmem_init(int argc, char **argv, struct shmem_res *res) {
 		}
 	}
 
-	res->addr = shmem_mount(SHMEM_PATH, total_size);
-	res->limit = res->addr;
-	res->manage = res->limit + 1;
-	res->bitmap_sem = (sem_t *)(res->manage + 1);
-	
-	// limit is a single integer, so bitmap is one int
-	res->bitmap = (uint8_t *)(res->bitmap_sem + 1);
-	
-	res->perfect_numbers_sem = (sem_t *)(res->bitmap + bitmap_size);
-	res->perfect_numbers = (int *)(res->perfect_numbers_sem + 1);
-	res->processes = (struct process *)(res->perfect_numbers + NPERFNUMS);
-	res->end = res->processes + NPROCS;
+	shmem_map(res, shmem_mount(SHMEM_PATH, shmem_size(limit, nprimes)), limit,
+			nprimes);
 
 	// Set the limit in shared memory so other processes know
 	*res->limit = limit;
 
+	// Number n is bit n - 1. Mark the numbers past the limit in its byte as
+	// tested, so that computes never claim them.
+	res->bitmap[limit / 8] |= (uint8_t)(0xff << (limit % 8));
+
+	// Computes factor with these instead of building their own
+	*res->nprimes = nprimes;
+	if (nprimes > 0) {
+		memcpy(res->primes, primes, nprimes * sizeof(uint32_t));
+	}
+	free(primes);
+
+	// Computes read this to know whether the bitmap holds exponents
+	*res->search = search;
+
 	// Set PID in shared memory so report knows what to kill
 	*res->manage = getpid();
 
@@ -718,7 +1073,7 @@ void shmem_cleanup(struct shmem_res *res) {
 	}
 }
 
-bool sock_init(int argc, char **argv, struct sock_res *res) {
+bool sock_init(int argc, char **argv, enum search search, struct sock_res *res) {
 	struct sockaddr_in servaddr;
 	int on = 1; // For setsockopt()
 	int i;
@@ -761,13 +1116,22 @@ bool sock_init(int argc, char **argv, struct sock_res *res) {
 	}
 
 	res->notify = -1;
-	res->nperfnums = 0;
-	res->limit = atoi(argv[LIMIT_ARG]);
+	res->nresults = 0;
+	memset(&res->stats, 0, sizeof(res->stats));
+	res->limit = strtoull(argv[LIMIT_ARG], NULL, 10);
+	res->search = search;
+	res->amicable.keys = NULL;
+	res->amicable.values = NULL;
 	res->highest_assigned = 0;
 	res->done = false;
 	res->maxfd = res->listen;
 	res->maxi = -1;
 	res->missed_some = false;
+	memset(res->held, 0, sizeof(res->held));
+	res->outstanding = 0;
+	res->gaps = NULL;
+	res->ngaps = 0;
+	res->gaps_size = 0;
 
 	for (i = 0; i < MAX_CLIENTS; i++) {
 		res->clients[i] = -1; // Denotes an unused index
@@ -776,6 +1140,11 @@ bool sock_init(int argc, char **argv, struct sock_res *res) {
 	FD_ZERO(&res->allfds);
 	FD_SET(res->listen, &res->allfds);
 
+	if ((search == SEARCH_AMICABLE) &&
+			(amicable_init(&res->amicable, res->limit) == false)) {
+		return false;
+	}
+
 	return true;
 }
 
@@ -828,20 +1197,32 @@ void sock_report(struct sock_res *res) {
 
 			if (FD_ISSET(fd, &rset)) {
 				bytes_read = get_packet(fd, &packet);
+
+				// A client stopping with ranges it asked for still unread
+				// resets the connection rather than closing it
+				if ((bytes_read == -1) && (errno == ECONNRESET)) {
+					bytes_read = 0;
+				}
+
 				if (bytes_read == 0) {
 					// Connection closed by client
 					if (fd == res->notify) {
 						// Unregister notify client
 						res->notify = -1;
 					}
+
+					// A client that dies mid-range never says how far it got
+					release_client(res, fd);
+					sock_settle(res);
+
 					close(fd);
 					FD_CLR(fd, &res->allfds);
 					res->clients[i] = -1;
+				} else if (bytes_read == -1) {
+					perror("Could not read packet");
 				} else if (bytes_read != sizeof(packet)) {
 					// Did not receive a full packet. Panic?
 					fprintf(stderr, "Did not receive a full packet\n");
-				} else if (bytes_read == -1) {
-					perror("Could not read packet");
 				} else {
 					done = sock_handle_packet(fd, res, &packet);
 				}
@@ -876,10 +1257,17 @@ void sock_cleanup(struct sock_res *res) {
 
 	close(res->listen);
 	res->listen = -1;
+
+	amicable_free(&res->amicable);
+	free(res->gaps);
+	res->gaps = NULL;
 }
 
 bool sock_handle_packet(int fd, struct sock_res *res, union packet *p) {
 	union packet outbound;
+	union packet pairs[ALIQUOT_BATCH];
+	unsigned int npairs;
+	unsigned int j;
 	int i;
 
 	assert(res != NULL);
@@ -887,7 +1275,9 @@ bool sock_handle_packet(int fd, struct sock_res *res, union packet *p) {
 
 	switch (p->id) {
 	case PACKETID_PERFNUM:
-		res->perfnums[res->nperfnums++] = p->perfnum.perfnum;
+	case PACKETID_MULTIPERFECT:
+	case PACKETID_AMICABLE:
+		save_result(res->results, &res->nresults, p);
 
 		// Notify client
 		if (res->notify != -1) {
@@ -895,31 +1285,38 @@ bool sock_handle_packet(int fd, struct sock_res *res, union packet *p) {
 		}
 
 		break;
-	case PACKETID_DONE:
-		if (res->highest_assigned < res->limit) {
-			outbound.id = PACKETID_RANGE;
-			outbound.range.start = res->highest_assigned + 1;
-			outbound.range.end = outbound.range.start + NASSIGN - 1;
-			res->highest_assigned = outbound.range.end;
-			send_packet(fd, &outbound);
-		} else {
-			res->done = true;
-			outbound.id = PACKETID_REFUSE;
-			send_packet(fd, &outbound);
-
+	case PACKETID_ALIQUOT:
+		npairs = match_aliquot(&res->amicable, &p->aliquot, pairs);
+		for (j = 0; j < npairs; j++) {
+			save_result(res->results, &res->nresults, &pairs[j]);
 			if (res->notify != -1) {
-				outbound.id = PACKETID_DONE;
-				send_packet(res->notify, &outbound);
+				send_packet(res->notify, &pairs[j]);
 			}
 		}
 		break;
+	case PACKETID_DONE:
+		// The client finished its oldest range, if it had one, and wants another
+		release_range(res, fd, false);
+		request_range(res, fd);
+		sock_settle(res);
+		break;
+	case PACKETID_PREFETCH:
+		// The client wants another range to test after those it holds
+		request_range(res, fd);
+		sock_settle(res);
+		break;
+	case PACKETID_STATS:
+		kernel_stats_add(&res->stats, &p->stats.stats);
+		break;
+	case PACKETID_REMAINDER:
+		res->held[fd].drained = true;
+		queue_gap(res, p->remainder.gap.start, p->remainder.gap.end);
+		break;
 	case PACKETID_CLOSED:
-		res->missed_some = true;
-
-		// Inform report
-		if (res->notify != -1) {
-			send_packet(res->notify, p);
-		}
+		// Whatever came back in remainder packets is queued again, and the
+		// rest of the range was tested
+		release_client(res, fd);
+		sock_settle(res);
 		break;
 	case PACKETID_KILL:
 		printf("Received shut down signal\n");
@@ -942,13 +1339,16 @@ bool sock_handle_packet(int fd, struct sock_res *res, union packet *p) {
 			}
 
 			// Send list of numbers already found
-			outbound.id = PACKETID_PERFNUM;
-			for (i = 0; i < res->nperfnums; i++) {
-				outbound.perfnum.perfnum = res->perfnums[i];
-				send_packet(fd, &outbound);
+			for (i = 0; i < res->nresults; i++) {
+				send_packet(fd, &res->results[i]);
 			}
 
 			if (res->done == true) {
+				outbound.id = PACKETID_STATS;
+				outbound.stats.pid = getpid();
+				outbound.stats.stats = res->stats;
+				send_packet(fd, &outbound);
+
 				outbound.id = PACKETID_DONE;
 				send_packet(fd, &outbound);
 			}
@@ -970,16 +1370,191 @@ bool sock_handle_packet(int fd, struct sock_res *res, union packet *p) {
 	return false;
 }
 
-int spawn_computes(pid_t **pids, int fds[2], int limit, int nprocs) {
+void queue_gap(struct sock_res *res, uint64_t start, uint64_t end) {
+	struct gap *gaps;
+	unsigned int size;
+
+	assert(res != NULL);
+	assert(start <= end);
+
+	if (res->ngaps == res->gaps_size) {
+		size = (res->gaps_size == 0) ? 16 : res->gaps_size * 2;
+		gaps = realloc(res->gaps, size * sizeof(struct gap));
+		if (gaps == NULL) {
+			perror("Could not allocate memory");
+			sock_missed(res);
+			return;
+		}
+		res->gaps = gaps;
+		res->gaps_size = size;
+	}
+
+	res->gaps[res->ngaps].start = start;
+	res->gaps[res->ngaps].end = end;
+	res->ngaps++;
+}
+
+bool assign_range(struct sock_res *res, int fd) {
+	union packet outbound;
+	uint64_t nassign = (res->search == SEARCH_EXPONENTS) ? NASSIGN_EXPONENTS : NASSIGN;
+	struct client_ranges *held = &res->held[fd];
+	struct gap *gap;
+
+	assert(res != NULL);
+	assert(held->count < PREFETCH_MAX);
+
+	outbound.id = PACKETID_RANGE;
+	outbound.range.search = res->search;
+
+	if (res->ngaps > 0) {
+		// Hand a long gap out a block at a time, like the rest
+		gap = &res->gaps[res->ngaps - 1];
+		outbound.range.start = gap->start;
+		if (gap->end - gap->start < nassign) {
+			outbound.range.end = gap->end;
+			res->ngaps--;
+		} else {
+			outbound.range.end = gap->start + nassign - 1;
+			gap->start += nassign;
+		}
+	} else if (res->highest_assigned < res->limit) {
+		outbound.range.start = res->highest_assigned + 1;
+
+		// Stop at the limit rather than running past it, which could wrap
+		// near 2^64
+		if (res->limit - res->highest_assigned <= nassign) {
+			outbound.range.end = res->limit;
+		} else {
+			outbound.range.end = res->highest_assigned + nassign;
+		}
+		res->highest_assigned = outbound.range.end;
+	} else {
+		return false;
+	}
+
+	gap = &held->ranges[(held->first + held->count) % PREFETCH_MAX];
+	gap->start = outbound.range.start;
+	gap->end = outbound.range.end;
+	held->count++;
+	res->outstanding++;
+	send_packet(fd, &outbound);
+
+	return true;
+}
+
+void release_range(struct sock_res *res, int fd, bool requeue) {
+	struct client_ranges *held = &res->held[fd];
+
+	assert(res != NULL);
+
+	if (held->count == 0) {
+		return;
+	}
+
+	if (requeue == true) {
+		queue_gap(res, held->ranges[held->first].start, held->ranges[held->first].end);
+	}
+
+	held->first = (held->first + 1) % PREFETCH_MAX;
+	held->count--;
+	held->drained = false;
+	res->outstanding--;
+}
+
+void release_client(struct sock_res *res, int fd) {
+	struct client_ranges *held = &res->held[fd];
+
+	assert(res != NULL);
+
+	release_range(res, fd, held->drained == false);
+	while (held->count > 0) {
+		release_range(res, fd, true);
+	}
+
+	held->first = 0;
+	held->waiting = 0;
+}
+
+void request_range(struct sock_res *res, int fd) {
+	struct client_ranges *held = &res->held[fd];
+
+	assert(res != NULL);
+
+	if (held->count + held->waiting < PREFETCH_MAX) {
+		held->waiting++;
+	}
+}
+
+void sock_settle(struct sock_res *res) {
+	union packet outbound;
+	int fd;
+
+	assert(res != NULL);
+
+	for (fd = 0; fd <= res->maxfd; fd++) {
+		while ((res->held[fd].waiting > 0) && (assign_range(res, fd) == true)) {
+			res->held[fd].waiting--;
+		}
+	}
+
+	// Clients still testing may yet return part of their range
+	if ((res->outstanding > 0) || (res->ngaps > 0) ||
+			(res->highest_assigned < res->limit)) {
+		return;
+	}
+
+	// Answer every request, since a client reads its replies in order
+	outbound.id = PACKETID_REFUSE;
+	for (fd = 0; fd <= res->maxfd; fd++) {
+		while (res->held[fd].waiting > 0) {
+			send_packet(fd, &outbound);
+			res->held[fd].waiting--;
+		}
+	}
+
+	if (res->done == true) {
+		return;
+	}
+	res->done = true;
+
+	if (res->notify != -1) {
+		outbound.id = PACKETID_STATS;
+		outbound.stats.pid = getpid();
+		outbound.stats.stats = res->stats;
+		send_packet(res->notify, &outbound);
+
+		outbound.id = PACKETID_DONE;
+		send_packet(res->notify, &outbound);
+	}
+}
+
+void sock_missed(struct sock_res *res) {
+	union packet outbound;
+
+	assert(res != NULL);
+
+	res->missed_some = true;
+
+	// Inform report
+	if (res->notify != -1) {
+		outbound.id = PACKETID_CLOSED;
+		outbound.closed.pid = PID_CLIENT;
+		send_packet(res->notify, &outbound);
+	}
+}
+
+int spawn_computes(pid_t **pids, int fds[2], uint64_t limit, int nprocs,
+		enum search search, const char *table, const char *stages, int threads,
+		const struct affinity *affinity) {
 	int flags;
-	int numbers_per_proc = floor((double)limit / (double)nprocs);
-	int end = 0;
+	uint64_t numbers_per_proc = limit / nprocs;
+	uint64_t end = 0;
 	int i;
 
 	assert(pids != NULL);
 	assert(fds != NULL);
 
-	*pids = (pid_t *)malloc(limit * sizeof(pid_t));
+	*pids = (pid_t *)malloc(nprocs * sizeof(pid_t));
 	if (*pids == NULL) {
 		perror("Could not allocate memory");
 		exit(EXIT_FAILURE);
@@ -991,11 +1566,7 @@ int spawn_computes(pid_t **pids, int fds[2], int limit, int nprocs) {
 	}
 
 	for (i = 0; i < nprocs; i++) {
-		pid_t pid;
-
-		char start_str[11];
-		char end_str[11];
-		int start;
+		uint64_t start;
 
 		// End is stored from previous loop
 		start = end + 1;
@@ -1007,41 +1578,12 @@ int spawn_computes(pid_t **pids, int fds[2], int limit, int nprocs) {
 			end = start + numbers_per_proc - 1;
 		}
 
-		snprintf(start_str, 11, "%d", start);
-		snprintf(end_str, 11, "%d", end);
-
-		pid = fork();
-		if (pid > 0) {
-			// Parent
-			(*pids)[i] = pid;
-		} else if (pid == 0) {
-			// Child
-
-			// Duplicate write end of pipe to stdout
-			if (dup2(fds[WRITE], STDOUT_FILENO) == -1) {
-				perror("Could not duplicate file descriptor");
-				return -1;
-			}
-
-			// Close read end of pipe
-			close(fds[READ]);
-			if (execl(COMPUTE_CMD,
-					COMPUTE_CMD,
-				   	"p",
-				   	start_str,
-					end_str,
-					NULL) == -1) {
-				perror("Unable to exec");
-				return -1;
-			}
-		} else {
-			// Error
-			perror("Unable to spawn compute");
-		}
+		(*pids)[i] = spawn_compute(fds, start, end, search, table, stages, threads,
+				(affinity != NULL) ? affinity_cpu(affinity, i) : -1);
 	}
 
-	// Now that all children have been spawned, close write end of pipe
-	close(fds[WRITE]);
+	// The write end stays open so that computes spawned later can share the
+	// pipe
 
 	if ((flags = fcntl(fds[READ], F_GETFL, 0)) == -1) {
 		flags = 0;
@@ -1055,6 +1597,156 @@ int spawn_computes(pid_t **pids, int fds[2], int limit, int nprocs) {
 	return 0;
 }
 
+pid_t spawn_compute(int fds[2], uint64_t start, uint64_t end, enum search search,
+		const char *table, const char *stages, int threads, int cpu) {
+	char *args[] = { COMPUTE_CMD, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+			NULL, NULL };
+	char threads_str[SNUMSTR];
+	char start_str[SNUMSTR];
+	char end_str[SNUMSTR];
+	int nargs = 1;
+	pid_t pid;
+
+	assert(fds != NULL);
+
+	snprintf(threads_str, SNUMSTR, "%d", threads);
+	snprintf(start_str, SNUMSTR, "%" PRIu64, start);
+	snprintf(end_str, SNUMSTR, "%" PRIu64, end);
+
+	pid = fork();
+	if (pid == 0) {
+		// Child
+
+		// Duplicate write end of pipe to stdout
+		if (dup2(fds[WRITE], STDOUT_FILENO) == -1) {
+			perror("Could not duplicate file descriptor");
+			exit(EXIT_FAILURE);
+		}
+
+		// Close read end of pipe
+		close(fds[READ]);
+
+		// Pin before exec so that every thread compute starts stays on the
+		// CPU. A failure has already been reported, and compute can still run
+		// unpinned.
+		if (cpu >= 0) {
+			affinity_pin(cpu);
+		}
+
+		// Options go before the mode
+		if (search == SEARCH_EXPONENTS) {
+			args[nargs++] = "-e";
+		} else if (search == SEARCH_MULTIPERFECT) {
+			args[nargs++] = "-m";
+		} else if (search == SEARCH_AMICABLE) {
+			args[nargs++] = "-a";
+		}
+		if (table != NULL) {
+			args[nargs++] = "-T";
+			args[nargs++] = (char *)table;
+		}
+		if (stages != NULL) {
+			args[nargs++] = "-p";
+			args[nargs++] = (char *)stages;
+		}
+		args[nargs++] = "-t";
+		args[nargs++] = threads_str;
+		args[nargs++] = "p";
+		args[nargs++] = start_str;
+		args[nargs++] = end_str;
+
+		execv(COMPUTE_CMD, args);
+		perror("Unable to exec");
+		exit(EXIT_FAILURE);
+	} else if (pid == -1) {
+		perror("Unable to spawn compute");
+	}
+
+	return pid;
+}
+
+bool respawn_compute(struct pipe_res *res, struct packet_remainder *remainder) {
+	pid_t *pids;
+	pid_t pid;
+	int cpu = -1;
+	int i;
+
+	assert(res != NULL);
+	assert(remainder != NULL);
+
+	pids = realloc(res->compute_pids, (res->nprocs + 1) * sizeof(pid_t));
+	if (pids == NULL) {
+		perror("Could not allocate memory");
+		return false;
+	}
+	res->compute_pids = pids;
+
+	// Run on the stopping compute's CPU, which it is about to give up
+	for (i = 0; (i < res->nprocs) && (res->affinity != NULL); i++) {
+		if (res->compute_pids[i] == remainder->pid) {
+			cpu = affinity_cpu(res->affinity, i);
+		}
+	}
+
+	pid = spawn_compute(res->compute_pipe, remainder->gap.start, remainder->gap.end,
+			res->search, res->table, res->stages, res->threads, cpu);
+	if (pid == -1) {
+		return false;
+	}
+
+	res->compute_pids[res->nprocs++] = pid;
+	return true;
+}
+
+void save_result(union packet *results, int *nresults, union packet *result) {
+	assert(results != NULL);
+	assert(nresults != NULL);
+	assert(result != NULL);
+
+	if (*nresults == SRESULTS) {
+		fprintf(stderr, "[manage] Too many perfect numbers to record\n");
+		return;
+	}
+
+	results[(*nresults)++] = *result;
+}
+
+bool pipe_forward(struct pipe_res *res, union packet *packet) {
+	assert(res != NULL);
+	assert(packet != NULL);
+
+	save_result(res->results, &res->nresults, packet);
+	if (send_packet(res->report_fifo, packet) == -1) {
+		if (errno != EPIPE) {
+			perror("Could not send packet");
+		} else {
+			fprintf(stderr, "Reporting process disconnected\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+unsigned int match_aliquot(struct amicable_join *join, struct packet_aliquot *aliquot,
+		union packet *pairs) {
+	unsigned int npairs = 0;
+	unsigned int i;
+
+	assert(join != NULL);
+	assert(aliquot != NULL);
+	assert(pairs != NULL);
+
+	for (i = 0; (i < aliquot->count) && (i < ALIQUOT_BATCH); i++) {
+		if (amicable_claim(join, aliquot->n[i], aliquot->s[i],
+				&pairs[npairs].amicable.a, &pairs[npairs].amicable.b) == true) {
+			pairs[npairs++].id = PACKETID_AMICABLE;
+		}
+	}
+
+	return npairs;
+}
+
 void collect_computes(struct pipe_res *res) {
 	int i;
 
@@ -1076,7 +1768,7 @@ void collect_computes(struct pipe_res *res) {
 	}
 }
 
-void *shmem_mount(char *path, int object_size) {
+void *shmem_mount(char *path, size_t object_size) {
 	int shmem_fd;
 	void *addr;
 
@@ -1116,6 +1808,7 @@ void accept_client(struct sock_res *res) {
 	// New client connection
 	len = sizeof(addr);
 	fd = accept(res->listen, (struct sockaddr*)&addr, &len);
+	sock_nodelay(fd);
 	for (i = 0; i <= FD_SETSIZE; i++) {
 		if (i == MAX_CLIENTS) {
 			perror("Client limit reached");
@@ -1139,7 +1832,27 @@ void accept_client(struct sock_res *res) {
 }
 
 void usage(void) {
-	fprintf(stdout, "Usage: manage [mps] <limit> <nprocs>\n");
+	fprintf(stdout, "Usage: manage [-a | -e | -m] [-c cpus] [-p stages | -s] [-T file] [mps]\n");
+	fprintf(stdout, "              <limit> <nprocs>\n");
+	fprintf(stdout, "\n");
+	fprintf(stdout, "Options:\n");
+	fprintf(stdout, "    -a:         also find amicable pairs with both members up to\n");
+	fprintf(stdout, "                limit, in pipe or socket mode\n");
+	fprintf(stdout, "    -c cpus:    pin the spawned computes one to a CPU, in pipe mode:\n");
+	fprintf(stdout, "                compact fills one NUMA node first, scatter spreads\n");
+	fprintf(stdout, "                over nodes, or list CPUs like 0-3,8; in the other\n");
+	fprintf(stdout, "                modes pass -c to each compute instead\n");
+	fprintf(stdout, "    -e:         search Mersenne exponents up to limit with the\n");
+	fprintf(stdout, "                Lucas-Lehmer test instead of testing integers\n");
+	fprintf(stdout, "    -m:         also find k-perfect numbers, sigma(n) = k * n for\n");
+	fprintf(stdout, "                any k >= 3, at the cost of the candidate prefilters\n");
+	fprintf(stdout, "    -p stages:  prefilter stages the spawned computes enable, in pipe\n");
+	fprintf(stdout, "                mode; see compute -p for the stages\n");
+	fprintf(stdout, "    -s:         strict, have the spawned computes test every candidate\n");
+	fprintf(stdout, "                with the kernel, in pipe mode\n");
+	fprintf(stdout, "    -T file:    have the spawned computes share a persistent table\n");
+	fprintf(stdout, "                of tested numbers, in pipe mode; in the other modes\n");
+	fprintf(stdout, "                pass -T to each compute instead\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "Modes:\n");
 	fprintf(stdout, "    m - shared memory\n");
@@ -1151,7 +1864,8 @@ void usage(void) {
 	fprintf(stdout, "        usage: manage p <limit> <nprocs>\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "        limit:      largest number to test\n");
-	fprintf(stdout, "        nprocs:     number of compute processes to spawn\n");
+	fprintf(stdout, "        nprocs:     number of compute processes to spawn, sharing the\n");
+	fprintf(stdout, "                    CPUs between their threads\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "    s - sockets\n");
 	fprintf(stdout, "        usage: manage s <limit>\n");
@@ -2,12 +2,21 @@ EXE = manage
 
 SHELL = sh
 CC = gcc
+CXX = g++
 REMOVE = rm -f
 REMOVEDIR = rm -rf
 
 SRC =	manage.c \
+		affinity.c \
+		amicable.c \
+		factor.c \
 		packets.c \
+		prefilter.c \
 		shmem.c \
+		sigma.c \
+		sock.c
+
+CXXSRC =	sigma_cxx.cpp \
 
 DEBUG = -g
 OPTIMIZATION = -O3
@@ -23,6 +32,15 @@ CFLAGS =	$(INCLUDEDIRS) \
 			-std=gnu99 \
 			$(OPTIMIZATION) \
 
+CXXFLAGS =	$(INCLUDEDIRS) \
+			-Wall \
+			-Wextra \
+			-std=c++17 \
+			-fno-exceptions \
+			-fno-rtti \
+			$(OPTIMIZATION) \
+			$(DEBUG) \
+
 LDFLAGS =	-lm \
 			-lrt \
 
@@ -31,8 +49,9 @@ GENDEPFLAGS = -MMD -MP -MF .dep/$(@F).d
 
 # Combine all necessary flags and optional flags.
 ALL_CFLAGS = $(CFLAGS) $(GENDEPFLAGS)
+ALL_CXXFLAGS = $(CXXFLAGS) $(GENDEPFLAGS)
 
-OBJ = $(SRC:%.c=$(OBJDIR)/%.o)
+OBJ = $(SRC:%.c=$(OBJDIR)/%.o) $(CXXSRC:%.cpp=$(OBJDIR)/%.o)
 
 all: $(EXE)
 
@@ -47,12 +66,18 @@ $(OBJDIR)/%.o : %.c
 	@echo Compiling: $<
 	$(CC) -c $(ALL_CFLAGS) $< -o $@ 
 
+# Compile: create object files from C++ source files.
+$(OBJDIR)/%.o : %.cpp
+	@echo Compiling: $<
+	$(CXX) -c $(ALL_CXXFLAGS) $< -o $@
+
 doc:
 	doxygen
 
 clean:
 	$(REMOVE) $(EXE)
 	$(REMOVE) $(SRC:%.c=$(OBJDIR)/%.o)
+	$(REMOVE) $(CXXSRC:%.cpp=$(OBJDIR)/%.o)
 	$(REMOVE) $(SRC:.c=.d)
 	$(REMOVEDIR) .dep
 	$(REMOVEDIR) $(OBJDIR)
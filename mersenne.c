@@ -0,0 +1,407 @@
+/**
+ * @file mersenne.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the Lucas-Lehmer test used to find even perfect numbers from their
+ * Mersenne exponents.
+ *
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mersenne.h"
+
+/// Number of bits in a limb of a multi-word number
+#define LIMB_BITS 64
+
+/// Trial factors divisible by one of these are skipped without powering
+static const uint32_t sieve_primes[] = {
+	3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61
+};
+
+/// Number of entries in sieve_primes
+#define NSIEVE_PRIMES (sizeof(sieve_primes) / sizeof(sieve_primes[0]))
+
+/// mersenne_depth() aims for 4 * log2(p) minus this many bits, which keeps
+/// trial factoring to about 5% of the Lucas-Lehmer test on this code
+#define MERSENNE_DEPTH_OFFSET 18
+
+/**
+ * @brief Checks if an exponent is prime by trial division
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param p Exponent to test
+ * @return true if p is prime, false otherwise
+ */
+static bool exponent_is_prime(unsigned int p);
+
+/**
+ * @brief Runs the Lucas-Lehmer test for 2^p - 1 below 2^64
+ *
+ * Preconditions: p is an odd prime less than 64
+ *
+ * Postconditions:
+ *
+ * @param p Exponent to test
+ * @return true if 2^p - 1 is prime, false otherwise
+ */
+static bool lucas_lehmer_word(unsigned int p);
+
+/**
+ * @brief Runs the Lucas-Lehmer test for 2^p - 1 of any size
+ *
+ * Preconditions: p is an odd prime
+ *
+ * Postconditions:
+ *
+ * @param p Exponent to test
+ * @return true if 2^p - 1 is prime, false otherwise
+ */
+static bool lucas_lehmer_multi(unsigned int p);
+
+/**
+ * @brief Squares a multi-word number modulo 2^p - 1
+ *
+ * Preconditions: s and t are not NULL, s has n limbs and is less than 2^p - 1,
+ * t has room for 2n limbs, p is odd, n is the number of limbs needed for p bits
+ *
+ * Postconditions: s holds s^2 mod 2^p - 1
+ *
+ * @param s Number to square, least significant limb first
+ * @param t Scratch space
+ * @param n Number of limbs in s
+ * @param p Mersenne exponent
+ */
+static void square_mod(uint64_t *s, uint64_t *t, unsigned int n, unsigned int p);
+
+/**
+ * @brief Computes 2^p mod q by binary powering
+ *
+ * Preconditions: q is odd and greater than 1
+ *
+ * Postconditions:
+ *
+ * @param p Exponent
+ * @param q Modulus
+ * @return 2^p mod q
+ */
+static uint64_t pow2_mod(unsigned int p, uint64_t q);
+
+bool mersenne_is_prime(unsigned int p) {
+	if (p == 2) {
+		// 3 is prime, but the Lucas-Lehmer test only applies to odd p
+		return true;
+	}
+
+	if (exponent_is_prime(p) == false) {
+		return false;
+	}
+
+	if (p < LIMB_BITS) {
+		return lucas_lehmer_word(p);
+	}
+
+	return lucas_lehmer_multi(p);
+}
+
+bool mersenne_trial_factor(unsigned int p, unsigned int depth, uint64_t *factor) {
+	uint32_t residue[NSIEVE_PRIMES];
+	uint32_t step[NSIEVE_PRIMES];
+	uint64_t limit;
+	uint64_t twice = 2 * (uint64_t)p;
+	uint64_t q;
+	unsigned int i;
+	bool sieved;
+
+	assert(factor != NULL);
+
+	if ((p < 3) || (exponent_is_prime(p) == false)) {
+		return false;
+	}
+
+	// A composite 2^p - 1 has a factor below its square root
+	if (depth > (p + 1) / 2) {
+		depth = (p + 1) / 2;
+	}
+	if (depth > MERSENNE_DEPTH_MAX) {
+		depth = MERSENNE_DEPTH_MAX;
+	}
+	limit = (depth == 64) ? UINT64_MAX : ((uint64_t)1 << depth) - 1;
+
+	q = twice + 1;
+	for (i = 0; i < NSIEVE_PRIMES; i++) {
+		residue[i] = q % sieve_primes[i];
+		step[i] = twice % sieve_primes[i];
+	}
+
+	while (q <= limit) {
+		if (((q & 7) == 1) || ((q & 7) == 7)) {
+			// A multiple of a small prime can't be the smallest factor,
+			// unless it is the small prime itself
+			sieved = false;
+			for (i = 0; i < NSIEVE_PRIMES; i++) {
+				if ((residue[i] == 0) && (q != sieve_primes[i])) {
+					sieved = true;
+					break;
+				}
+			}
+
+			if ((sieved == false) && (pow2_mod(p, q) == 1)) {
+				*factor = q;
+				return true;
+			}
+		}
+
+		if (q > limit - twice) {
+			break;
+		}
+		q += twice;
+		for (i = 0; i < NSIEVE_PRIMES; i++) {
+			residue[i] += step[i];
+			if (residue[i] >= sieve_primes[i]) {
+				residue[i] -= sieve_primes[i];
+			}
+		}
+	}
+
+	return false;
+}
+
+unsigned int mersenne_depth(unsigned int p) {
+	unsigned __int128 fourth;
+	uint64_t high;
+	unsigned int bits;
+
+	if (p < LIMB_BITS) {
+		return 0;
+	}
+
+	// floor(4 * log2(p)) is the position of the top bit of p^4, which fits
+	// in 128 bits for any unsigned int
+	fourth = (unsigned __int128)p * p * p * p;
+	high = (uint64_t)(fourth >> 64);
+	bits = (high != 0) ? 127 - __builtin_clzll(high) : 63 - __builtin_clzll((uint64_t)fourth);
+
+	if (bits <= MERSENNE_DEPTH_OFFSET) {
+		return 0;
+	}
+	if (bits - MERSENNE_DEPTH_OFFSET > MERSENNE_DEPTH_MAX) {
+		return MERSENNE_DEPTH_MAX;
+	}
+
+	return bits - MERSENNE_DEPTH_OFFSET;
+}
+
+uint64_t mersenne_perfect(unsigned int p) {
+	if ((p < 2) || ((2 * p - 1) > LIMB_BITS)) {
+		return 0;
+	}
+
+	return ((uint64_t)1 << (p - 1)) * (((uint64_t)1 << p) - 1);
+}
+
+static bool exponent_is_prime(unsigned int p) {
+	unsigned int i;
+
+	if (p < 2) {
+		return false;
+	}
+
+	for (i = 2; i <= p / i; i++) {
+		if ((p % i) == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool lucas_lehmer_word(unsigned int p) {
+	uint64_t m = ((uint64_t)1 << p) - 1;
+	unsigned __int128 x;
+	uint64_t s = 4;
+	unsigned int i;
+
+	assert(p < LIMB_BITS);
+
+	for (i = 0; i < p - 2; i++) {
+		x = (unsigned __int128)s * s;
+
+		// 2^p == 1 (mod m), so fold the high bits onto the low bits
+		x = (x & m) + (x >> p);
+		x = (x & m) + (x >> p);
+		s = (uint64_t)x;
+		if (s >= m) {
+			s -= m;
+		}
+
+		s = (s >= 2) ? (s - 2) : (s + m - 2);
+	}
+
+	return (s == 0);
+}
+
+static bool lucas_lehmer_multi(unsigned int p) {
+	unsigned int n = (p + LIMB_BITS - 1) / LIMB_BITS;
+	uint64_t *s;
+	uint64_t *t;
+	uint64_t borrow;
+	bool prime;
+	unsigned int i;
+	unsigned int k;
+
+	s = (uint64_t *)calloc(3 * n, sizeof(uint64_t));
+	if (s == NULL) {
+		perror("Could not allocate Lucas-Lehmer residue");
+		return false;
+	}
+	t = s + n;
+
+	s[0] = 4;
+	for (i = 0; i < p - 2; i++) {
+		square_mod(s, t, n, p);
+
+		// Subtract 2, wrapping to s + m - 2 when s < 2. m - 2 is all ones
+		// but for bit 0 and the bits above p.
+		borrow = (s[0] < 2);
+		s[0] -= 2;
+		for (k = 1; (k < n) && (borrow != 0); k++) {
+			borrow = (s[k] == 0);
+			s[k]--;
+		}
+		if (borrow != 0) {
+			// Wrapped below zero, adding m is the same as dropping the
+			// bits at and above p and subtracting 1 more
+			s[n - 1] &= ((uint64_t)1 << (p % LIMB_BITS)) - 1;
+			borrow = (s[0] == 0);
+			s[0]--;
+			for (k = 1; (k < n) && (borrow != 0); k++) {
+				borrow = (s[k] == 0);
+				s[k]--;
+			}
+		}
+	}
+
+	prime = true;
+	for (k = 0; k < n; k++) {
+		if (s[k] != 0) {
+			prime = false;
+			break;
+		}
+	}
+
+	free(s);
+
+	return prime;
+}
+
+static uint64_t pow2_mod(unsigned int p, uint64_t q) {
+	uint64_t r = 1;
+	int bit;
+
+	assert((q & 1) == 1);
+	assert(q > 1);
+
+	for (bit = 31 - __builtin_clz(p); bit >= 0; bit--) {
+		// Below 2^32 the square fits in a word, which avoids a 128-bit divide
+		if (q <= UINT32_MAX) {
+			r = (r * r) % q;
+		} else {
+			r = (uint64_t)(((unsigned __int128)r * r) % q);
+		}
+
+		if (((p >> bit) & 1) != 0) {
+			// r < q, so doubling wraps at most once
+			r = (r >= q - r) ? r - (q - r) : 2 * r;
+		}
+	}
+
+	return r;
+}
+
+static void square_mod(uint64_t *s, uint64_t *t, unsigned int n, unsigned int p) {
+	unsigned int word = p / LIMB_BITS;
+	unsigned int bit = p % LIMB_BITS;
+	uint64_t mask = ((uint64_t)1 << bit) - 1;
+	unsigned __int128 acc;
+	uint64_t carry;
+	uint64_t high;
+	unsigned int i;
+	unsigned int j;
+
+	assert(bit != 0);
+
+	memset(t, 0, 2 * n * sizeof(uint64_t));
+
+	// Schoolbook square into t
+	for (i = 0; i < n; i++) {
+		carry = 0;
+		for (j = 0; j < n; j++) {
+			acc = (unsigned __int128)s[i] * s[j] + t[i + j] + carry;
+			t[i + j] = (uint64_t)acc;
+			carry = (uint64_t)(acc >> LIMB_BITS);
+		}
+		t[i + n] = carry;
+	}
+
+	// t = high * 2^p + low and 2^p == 1, so s = low + high
+	carry = 0;
+	for (i = 0; i < n; i++) {
+		high = t[word + i] >> bit;
+		if (word + i + 1 < 2 * n) {
+			high |= t[word + i + 1] << (LIMB_BITS - bit);
+		}
+
+		acc = (unsigned __int128)(i < n - 1 ? t[i] : (t[i] & mask)) + high + carry;
+		s[i] = (uint64_t)acc;
+		carry = (uint64_t)(acc >> LIMB_BITS);
+	}
+
+	// The sum is below 2^(p + 1), fold the bits above p back in until none
+	// are left
+	while ((high = (s[n - 1] >> bit)) != 0) {
+		s[n - 1] &= mask;
+		for (i = 0; (i < n) && (high != 0); i++) {
+			s[i] += high;
+			high = (s[i] < high);
+		}
+	}
+
+	// 2^p - 1 itself is 0
+	for (i = 0; i < n - 1; i++) {
+		if (s[i] != UINT64_MAX) {
+			return;
+		}
+	}
+	if (s[n - 1] == mask) {
+		memset(s, 0, n * sizeof(uint64_t));
+	}
+}
+
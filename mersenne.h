@@ -0,0 +1,109 @@
+/**
+ * @file mersenne.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the Lucas-Lehmer test used to find even perfect numbers from their
+ * Mersenne exponents.
+ *
+ */
+#ifndef MERSENNE_H
+#define MERSENNE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Largest trial factoring depth in bits, since factors are kept in a word
+#define MERSENNE_DEPTH_MAX 64
+
+/**
+ * @brief Checks if 2^p - 1 is a Mersenne prime
+ *
+ * Composite exponents are rejected by trial division, since 2^p - 1 is
+ * composite whenever p is. Prime exponents are checked with the Lucas-Lehmer
+ * test, using 128-bit arithmetic when 2^p - 1 fits in a word and multi-word
+ * arithmetic otherwise.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param p Exponent to test
+ * @return true if 2^p - 1 is prime, false otherwise
+ */
+bool mersenne_is_prime(unsigned int p);
+
+/**
+ * @brief Looks for a small factor of 2^p - 1 before the Lucas-Lehmer test
+ *
+ * Every factor q of 2^p - 1 with p an odd prime has the form 2kp + 1 and is 1
+ * or 7 mod 8. Candidates q are stepped through k, sieved by keeping their
+ * residues modulo a few small primes, and the survivors are tested with
+ * 2^p mod q by binary powering. Only factors below the square root of 2^p - 1
+ * are tried, so q is never 2^p - 1 itself.
+ *
+ * Preconditions: factor is not NULL
+ *
+ * Postconditions: factor holds the factor found, if any
+ *
+ * @param p Exponent to test
+ * @param depth Try factors below 2^depth, up to MERSENNE_DEPTH_MAX
+ * @param factor Pointer to load the factor found into
+ * @return true if 2^p - 1 has a factor below 2^depth, false if none was found
+ * or p is not an odd prime
+ */
+bool mersenne_trial_factor(unsigned int p, unsigned int depth, uint64_t *factor);
+
+/**
+ * @brief Picks how deep trial factoring pays off for an exponent
+ *
+ * The Lucas-Lehmer test for p takes p squarings of p-bit numbers, so it grows
+ * with p^3, while trial factoring to depth d tries about 2^d / (2p)
+ * candidates. The depth returned, about 4 * log2(p) - 18, keeps the trial
+ * factoring well under the cost of the test it may save. Exponents below 64
+ * get 0, since a single word test is cheaper than any sieve.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param p Exponent to test
+ * @return Depth in bits, 0 to skip trial factoring
+ */
+unsigned int mersenne_depth(unsigned int p);
+
+/**
+ * @brief Computes the even perfect number 2^(p - 1) * (2^p - 1)
+ *
+ * Preconditions: 2^p - 1 is prime
+ *
+ * Postconditions:
+ *
+ * @param p Mersenne exponent
+ * @return The perfect number, or 0 if it does not fit in 64 bits
+ */
+uint64_t mersenne_perfect(unsigned int p);
+
+#endif // MERSENNE_H
+
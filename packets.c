@@ -28,20 +28,55 @@
  *
  */
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include "packets.h"
 
 int get_packet(int fd, union packet *p) {
+	ssize_t total;
+	ssize_t bytes;
+
 	assert(p != NULL);
 
 	memset(p, 0, sizeof(union packet));
-	return read(fd, p, sizeof(union packet));
+	total = read(fd, p, sizeof(union packet));
+
+	// Pipes deliver whole packets, but a socket may split one, so once part
+	// of a packet has arrived wait for the rest
+	while ((total > 0) && ((size_t)total < sizeof(union packet))) {
+		bytes = read(fd, (char *)p + total, sizeof(union packet) - total);
+		if (bytes == 0) {
+			break;
+		} else if (bytes == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN)) {
+				continue;
+			}
+			return -1;
+		}
+		total += bytes;
+	}
+
+	return total;
 }
 
 int send_packet(int fd, union packet *p) {
+	ssize_t total = 0;
+	ssize_t bytes;
+
 	assert(p != NULL);
 
-	return write(fd, p, sizeof(union packet));
+	while ((size_t)total < sizeof(union packet)) {
+		bytes = write(fd, (char *)p + total, sizeof(union packet) - total);
+		if (bytes == -1) {
+			if ((errno == EINTR) && (total > 0)) {
+				continue;
+			}
+			return -1;
+		}
+		total += bytes;
+	}
+
+	return total;
 }
 
@@ -31,6 +31,7 @@
 #define PACKETS_H
 
 #include <unistd.h>
+#include "sigma.h"
 
 /// Server "pid" for closed packets in socket mode
 #define PID_SERVER ((pid_t)0)
@@ -38,6 +39,10 @@
 /// Client "pid" for closed packets in socket mode
 #define PID_CLIENT ((pid_t)1)
 
+/// Most ranges a socket client may hold at once, the one it is testing and
+/// those it asked for ahead of time
+#define PREFETCH_MAX 8
+
 /**
  * Packet identifier constants
  */
@@ -50,9 +55,29 @@ enum packet_id {
 	PACKETID_PERFNUM,
 	PACKETID_NOTIFY,
 	PACKETID_ACCEPT,
-	PACKETID_REFUSE
+	PACKETID_REFUSE,
+	PACKETID_STATS,
+	PACKETID_MULTIPERFECT,
+	PACKETID_ALIQUOT,
+	PACKETID_AMICABLE,
+	PACKETID_REMAINDER,
+	PACKETID_PREFETCH
+};
+
+/**
+ * Kinds of numbers a range can cover
+ */
+enum search {
+	SEARCH_INTEGERS,	///< Every integer in the range is a candidate
+	SEARCH_EXPONENTS,	///< Every integer in the range is a Mersenne exponent
+	SEARCH_MULTIPERFECT,	///< Every integer in the range is a candidate for any k
+	SEARCH_AMICABLE		///< Every integer in the range is a candidate or half a pair
 };
 
+/// Number of aliquot sums carried by one 'aliquot' packet, sized so the
+/// packet is no larger than a 'stats' packet
+#define ALIQUOT_BATCH 4
+
 /**
  * 'done' packet payload
  */
@@ -74,8 +99,9 @@ struct packet_closed {
  */
 struct packet_range {
 	enum packet_id packet_id;	///< Packet identifier
-	int start;					///< Start of assigned range
-	int end;					///< End of assigned range
+	uint64_t start;				///< Start of assigned range
+	uint64_t end;				///< End of assigned range
+	enum search search;			///< What the numbers in the range are
 };
 
 /**
@@ -83,7 +109,64 @@ struct packet_range {
  */
 struct packet_perfnum {
 	enum packet_id packet_id;	///< Packet identifier
-	int perfnum;				///< Perfect number
+	uint64_t perfnum;			///< Perfect number, 0 if it does not fit
+	unsigned int exponent;		///< p if perfnum is 2^(p-1)(2^p-1), 0 otherwise
+};
+
+/**
+ * 'multiperfect' packet payload
+ */
+struct packet_multiperfect {
+	enum packet_id packet_id;	///< Packet identifier
+	uint64_t n;					///< Number whose divisors sum to k * n
+	unsigned int k;				///< Multiple of n, at least 3
+};
+
+/**
+ * 'aliquot' packet payload, aliquot sums for manage to match amicable pairs
+ * across ranges
+ */
+struct packet_aliquot {
+	enum packet_id packet_id;	///< Packet identifier
+	unsigned int count;			///< Number of entries used
+	uint64_t n[ALIQUOT_BATCH];	///< Numbers tested
+	uint64_t s[ALIQUOT_BATCH];	///< sigma(n) - n for each number
+};
+
+/**
+ * 'amicable' packet payload
+ */
+struct packet_amicable {
+	enum packet_id packet_id;	///< Packet identifier
+	uint64_t a;					///< Smaller member of the pair
+	uint64_t b;					///< Larger member of the pair
+};
+
+/**
+ * Range of numbers a compute was assigned but did not test
+ */
+struct gap {
+	uint64_t start;				///< First number not tested
+	uint64_t end;				///< Last number not tested
+};
+
+/**
+ * 'remainder' packet payload, sent by a compute stopping mid-range for each
+ * piece of its range it did not test, just before its 'closed' packet
+ */
+struct packet_remainder {
+	enum packet_id packet_id;	///< Packet identifier
+	pid_t pid;					///< Process ID of the sending process
+	struct gap gap;				///< Numbers not tested
+};
+
+/**
+ * 'stats' packet payload
+ */
+struct packet_stats {
+	enum packet_id packet_id;	///< Packet identifier
+	pid_t pid;					///< Process ID of the sending process
+	struct kernel_stats stats;	///< Counters since the last stats packet
 };
 
 /**
@@ -95,6 +178,11 @@ union packet {
 	struct packet_closed closed;
 	struct packet_range range;
 	struct packet_perfnum perfnum;
+	struct packet_multiperfect multiperfect;
+	struct packet_aliquot aliquot;
+	struct packet_amicable amicable;
+	struct packet_stats stats;
+	struct packet_remainder remainder;
 };
 
 /**
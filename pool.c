@@ -0,0 +1,440 @@
+/**
+ * @file pool.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the worker pool compute uses to test one assignment on several
+ * threads at once.
+ *
+ */
+#define _GNU_SOURCE // For sched_getaffinity() and CPU_COUNT()
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h> // For nanosleep()
+#include "affinity.h"
+#include "pool.h"
+
+/// Failed steal rounds spent yielding before an idle worker starts sleeping
+#define POOL_SPINS 64
+
+/// Nanoseconds an idle worker sleeps between steal rounds after that
+#define POOL_NAP_NS 50000
+
+/**
+ * @brief Pushes a piece on the bottom of a worker's own deque
+ *
+ * Preconditions: Called by the worker owning the deque
+ *
+ * Postconditions: The piece is visible to thieves if it fit
+ *
+ * @param self Worker owning the deque
+ * @param start First number of the piece
+ * @param end Last number of the piece
+ * @return true if the piece was pushed, false if the deque is full
+ */
+static bool pool_push(struct pool_worker *self, uint64_t start, uint64_t end);
+
+/**
+ * @brief Takes the newest piece from the bottom of a worker's own deque
+ *
+ * Preconditions: Called by the worker owning the deque, start and end are not
+ * NULL
+ *
+ * Postconditions: The piece has been removed from the deque if there was one
+ *
+ * @param self Worker owning the deque
+ * @param start Pointer to load the first number of the piece into
+ * @param end Pointer to load the last number of the piece into
+ * @return true if a piece was taken, false if the deque was empty or a thief
+ * took the last piece first
+ */
+static bool pool_take(struct pool_worker *self, uint64_t *start, uint64_t *end);
+
+/**
+ * @brief Steals the oldest piece from the top of another worker's deque
+ *
+ * Preconditions: start and end are not NULL
+ *
+ * Postconditions: The piece has been removed from the deque if one was stolen
+ *
+ * @param victim Worker to steal from
+ * @param start Pointer to load the first number of the piece into
+ * @param end Pointer to load the last number of the piece into
+ * @return true if a piece was stolen, false if the deque was empty or another
+ * worker got the piece first
+ */
+static bool pool_steal(struct pool_worker *victim, uint64_t *start, uint64_t *end);
+
+/**
+ * @brief Splits a piece down to the grain and runs fn on what is left
+ *
+ * The upper half of each split is pushed on the worker's deque for it or a
+ * thief to run later. If the deque is full the rest of the piece is run
+ * whole, as is every piece once one has failed.
+ *
+ * Preconditions: start and end lie on the current range's chunks
+ *
+ * Postconditions: The lower part of the piece has been run and counted off
+ * remaining
+ *
+ * @param self Worker running the piece
+ * @param start First number of the piece
+ * @param end Last number of the piece
+ */
+static void pool_piece(struct pool_worker *self, uint64_t start, uint64_t end);
+
+/**
+ * @brief Works on the current range until every piece has finished
+ *
+ * Preconditions: A range has been posted
+ *
+ * Postconditions: remaining is 0
+ *
+ * @param self Worker to run
+ */
+static void pool_work(struct pool_worker *self);
+
+/**
+ * @brief Waits for ranges and works on them until the pool quits
+ *
+ * Preconditions: arg is the worker this thread runs
+ *
+ * Postconditions: The pool has quit
+ *
+ * @param arg Worker to run
+ * @return NULL
+ */
+static void *pool_thread(void *arg);
+
+bool pool_init(struct pool *pool, unsigned int nthreads, const int *cpus, bool bind) {
+	struct pool_worker *self;
+	sigset_t all;
+	sigset_t old;
+	unsigned int i;
+	int err;
+
+	assert(pool != NULL);
+	assert(nthreads > 0);
+
+	// The deque indices are aligned to cache lines, which malloc() does not
+	// promise
+	err = posix_memalign((void **)&pool->workers, POOL_LINE,
+			nthreads * sizeof(struct pool_worker));
+	if (err != 0) {
+		errno = err;
+		perror("Could not allocate worker threads");
+		pool->workers = NULL;
+		return false;
+	}
+	memset(pool->workers, 0, nthreads * sizeof(struct pool_worker));
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+	pool->nthreads = 0;
+	pool->generation = 0;
+	pool->active = 0;
+	pool->quit = false;
+	pool->bind = bind;
+	pool->fn = NULL;
+	pool->arg = NULL;
+	pool->start = 0;
+	pool->end = 0;
+	pool->chunks = 0;
+	pool->grain = 0;
+	pool->remaining = 0;
+	pool->failed = false;
+
+	// Threads inherit the signal mask of the thread creating them
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+
+	for (i = 0; i < nthreads; i++) {
+		self = &pool->workers[i];
+		self->pool = pool;
+		self->index = i;
+		self->cpu = (cpus != NULL) ? cpus[i] : -1;
+
+		err = pthread_create(&self->thread, NULL, pool_thread, self);
+		if (err != 0) {
+			errno = err;
+			perror("Could not start worker thread");
+			break;
+		}
+		pool->nthreads++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (pool->nthreads < nthreads) {
+		pool_destroy(pool);
+		return false;
+	}
+
+	return true;
+}
+
+bool pool_run(struct pool *pool, uint64_t start, uint64_t end, uint64_t grain,
+		pool_fn fn, void *arg) {
+	bool failed;
+
+	assert(pool != NULL);
+	assert(end >= start);
+	assert(grain > 0);
+	assert(fn != NULL);
+
+	pthread_mutex_lock(&pool->lock);
+
+	// Every worker is idle, so the range can be written plainly; the mutex
+	// publishes it to them
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->start = start;
+	pool->end = end;
+	pool->chunks = (end - start) / grain + 1;
+	pool->grain = grain;
+	pool->remaining = end - start + 1;
+	pool->failed = false;
+
+	pool->generation++;
+	pool->active = pool->nthreads;
+	pthread_cond_broadcast(&pool->work);
+
+	// Waiting for every worker, not just for remaining to reach 0, keeps one
+	// still looking for pieces from stealing into the next range
+	while (pool->active > 0) {
+		pthread_cond_wait(&pool->idle, &pool->lock);
+	}
+
+	failed = pool->failed;
+	pthread_mutex_unlock(&pool->lock);
+
+	return (failed == false);
+}
+
+void pool_destroy(struct pool *pool) {
+	unsigned int i;
+
+	assert(pool != NULL);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->nthreads; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+
+	pthread_cond_destroy(&pool->idle);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->workers);
+	pool->workers = NULL;
+	pool->nthreads = 0;
+}
+
+static bool pool_push(struct pool_worker *self, uint64_t start, uint64_t end) {
+	int64_t bottom;
+	int64_t top;
+
+	bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED);
+	top = __atomic_load_n(&self->top, __ATOMIC_ACQUIRE);
+	if (bottom - top >= POOL_DEQUE_SIZE) {
+		return false;
+	}
+
+	__atomic_store_n(&self->start[bottom % POOL_DEQUE_SIZE], start, __ATOMIC_RELAXED);
+	__atomic_store_n(&self->end[bottom % POOL_DEQUE_SIZE], end, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+static bool pool_take(struct pool_worker *self, uint64_t *start, uint64_t *end) {
+	int64_t bottom;
+	int64_t top;
+	bool taken = true;
+
+	bottom = __atomic_load_n(&self->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&self->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&self->top, __ATOMIC_RELAXED);
+
+	if (top > bottom) {
+		// Empty
+		__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	*start = __atomic_load_n(&self->start[bottom % POOL_DEQUE_SIZE], __ATOMIC_RELAXED);
+	*end = __atomic_load_n(&self->end[bottom % POOL_DEQUE_SIZE], __ATOMIC_RELAXED);
+
+	if (top == bottom) {
+		// Last piece, so race the thieves for it
+		taken = __atomic_compare_exchange_n(&self->top, &top, top + 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+		__atomic_store_n(&self->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return taken;
+}
+
+static bool pool_steal(struct pool_worker *victim, uint64_t *start, uint64_t *end) {
+	int64_t bottom;
+	int64_t top;
+
+	top = __atomic_load_n(&victim->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bottom = __atomic_load_n(&victim->bottom, __ATOMIC_ACQUIRE);
+
+	if (top >= bottom) {
+		return false;
+	}
+
+	*start = __atomic_load_n(&victim->start[top % POOL_DEQUE_SIZE], __ATOMIC_RELAXED);
+	*end = __atomic_load_n(&victim->end[top % POOL_DEQUE_SIZE], __ATOMIC_RELAXED);
+
+	return __atomic_compare_exchange_n(&victim->top, &top, top + 1, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static void pool_piece(struct pool_worker *self, uint64_t start, uint64_t end) {
+	struct pool *pool = self->pool;
+	uint64_t chunks;
+	uint64_t mid;
+
+	// Keep the lower half and leave the upper half for later or for a thief.
+	// After a failure pieces go to fn whole, for it to account for quickly.
+	chunks = (end - start) / pool->grain + 1;
+	while ((chunks > 1) && (__atomic_load_n(&pool->failed, __ATOMIC_RELAXED) == false)) {
+		mid = start + (chunks / 2) * pool->grain;
+		if (pool_push(self, mid, end) == false) {
+			break;
+		}
+		end = mid - 1;
+		chunks = (end - start) / pool->grain + 1;
+	}
+
+	if (pool->fn(start, end, pool->arg) == false) {
+		__atomic_store_n(&pool->failed, true, __ATOMIC_RELAXED);
+	}
+
+	__atomic_sub_fetch(&pool->remaining, end - start + 1, __ATOMIC_ACQ_REL);
+}
+
+static void pool_work(struct pool_worker *self) {
+	struct pool *pool = self->pool;
+	struct timespec nap = { 0, POOL_NAP_NS };
+	unsigned int idle = 0;
+	unsigned int i;
+	uint64_t first;
+	uint64_t last;
+	uint64_t start;
+	uint64_t end;
+
+	// Start on an even share of the chunks. The product needs 128 bits.
+	first = (unsigned __int128)pool->chunks * self->index / pool->nthreads;
+	last = (unsigned __int128)pool->chunks * (self->index + 1) / pool->nthreads;
+	if (last > first) {
+		start = pool->start + first * pool->grain;
+		end = pool->start + last * pool->grain - 1;
+		if (last == pool->chunks) {
+			// The last chunk may be short
+			end = pool->end;
+		}
+		pool_piece(self, start, end);
+	}
+
+	while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) != 0) {
+		if (pool_take(self, &start, &end) == true) {
+			pool_piece(self, start, end);
+			idle = 0;
+			continue;
+		}
+
+		for (i = 1; i < pool->nthreads; i++) {
+			if (pool_steal(&pool->workers[(self->index + i) % pool->nthreads], &start,
+					&end) == true) {
+				break;
+			}
+		}
+
+		if (i < pool->nthreads) {
+			pool_piece(self, start, end);
+			idle = 0;
+		} else if (idle++ < POOL_SPINS) {
+			sched_yield();
+		} else {
+			// The pieces left are all running, which may take a while
+			nanosleep(&nap, NULL);
+		}
+	}
+}
+
+static void *pool_thread(void *arg) {
+	struct pool_worker *self = arg;
+	struct pool *pool;
+	unsigned int generation = 0;
+
+	assert(self != NULL);
+	pool = self->pool;
+
+	// A failure has already been reported, and the worker can still run
+	// wherever the scheduler puts it
+	if ((self->cpu >= 0) && (affinity_pin(self->cpu) == true) && (pool->bind == true)) {
+		affinity_bind(affinity_node(self->cpu));
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while ((pool->quit == false) && (pool->generation == generation)) {
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+
+		if (pool->quit == true) {
+			break;
+		}
+
+		generation = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool_work(self);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->active--;
+		if (pool->active == 0) {
+			pthread_cond_signal(&pool->idle);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
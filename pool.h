@@ -0,0 +1,158 @@
+/**
+ * @file pool.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the worker pool compute uses to test one assignment on several
+ * threads at once.
+ *
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Pieces a worker's deque can hold. Each split pushes a piece at most half
+/// the size of the one below it, so a deque never holds much more than 64.
+#define POOL_DEQUE_SIZE 256
+
+/// Cache line size, so that one worker's deque indices don't share a line
+/// with another's
+#define POOL_LINE 64
+
+/**
+ * Signature of the functions workers run on each piece of a range. Returns
+ * false to stop the pool running the rest of the range.
+ */
+typedef bool (*pool_fn)(uint64_t start, uint64_t end, void *arg);
+
+/**
+ * Chase-Lev work-stealing deque of subranges, one per worker. The owner pushes
+ * and takes pieces at the bottom, other workers steal them from the top, so
+ * thieves get the oldest and largest pieces. Pieces are kept as separate start
+ * and end arrays so that every access is a single atomic word.
+ */
+struct pool_worker {
+	int64_t top __attribute__((aligned(POOL_LINE)));	///< Next piece to steal
+	int64_t bottom __attribute__((aligned(POOL_LINE)));	///< Next free slot, moved by the owner only
+	uint64_t start[POOL_DEQUE_SIZE];	///< First number of each piece
+	uint64_t end[POOL_DEQUE_SIZE];		///< Last number of each piece
+	struct pool *pool;		///< Pool this worker belongs to
+	unsigned int index;		///< Position in the pool's workers array
+	int cpu;				///< CPU the worker is pinned to, -1 if none
+	pthread_t thread;		///< Thread running the worker
+};
+
+/**
+ * Worker threads and the range they are splitting between them. lock
+ * protects generation, active and quit; the rest of the current range is
+ * only written by pool_run() while every worker is idle, or atomically.
+ */
+struct pool {
+	struct pool_worker *workers;	///< One entry per worker thread
+	unsigned int nthreads;	///< Number of worker threads
+	pthread_mutex_t lock;	///< Protects generation, active and quit
+	pthread_cond_t work;	///< Signaled when a range is posted or the pool quits
+	pthread_cond_t idle;	///< Signaled when the last worker finishes a range
+	unsigned int generation;	///< Incremented for each range posted
+	unsigned int active;	///< Workers still working on the current range
+	bool quit;				///< Workers should exit
+	bool bind;				///< Workers allocate memory on their CPU's node
+	pool_fn fn;				///< Function run on each piece
+	void *arg;				///< Argument passed to fn
+	uint64_t start;			///< First number of the current range
+	uint64_t end;			///< Last number of the current range
+	uint64_t chunks;		///< Number of grain sized chunks in the range
+	uint64_t grain;			///< Pieces are not split below this many numbers
+	uint64_t remaining;		///< Numbers not finished yet, updated atomically
+	bool failed;			///< A piece returned false, updated atomically
+};
+
+/**
+ * @brief Starts the worker threads
+ *
+ * Workers start with every signal blocked, so signals are still delivered to
+ * the thread that created the pool and interrupt its blocking calls as before.
+ * Each worker pins itself to its CPU, if it has one, before taking any work,
+ * so its first touches of memory already come from that CPU's node.
+ *
+ * Preconditions: pool is not NULL, nthreads is positive, cpus is NULL or has
+ * nthreads entries
+ *
+ * Postconditions: The workers are waiting for a range, or nothing is left
+ * allocated on failure
+ *
+ * @param pool Pool to start
+ * @param nthreads Number of worker threads
+ * @param cpus CPU to pin each worker to, NULL to leave them unpinned
+ * @param bind Whether pinned workers also bind their memory to their CPU's
+ * NUMA node
+ * @return true on success, false otherwise
+ */
+bool pool_init(struct pool *pool, unsigned int nthreads, const int *cpus, bool bind);
+
+/**
+ * @brief Runs fn over a range on the workers and waits for them to finish
+ *
+ * Each worker starts with an even share of the range and splits it in half
+ * recursively, running the lower half and leaving the upper half on its
+ * deque, until a piece is down to grain numbers. A worker that runs out steals
+ * the largest piece left on another worker's deque, so a share full of costly
+ * candidates ends up spread over every worker. Pieces are split on multiples
+ * of grain from start. Once a piece fails, the pieces not yet started are no
+ * longer split but still handed to fn, so that it can account for the
+ * numbers it will not get to; fn should return quickly then.
+ *
+ * Preconditions: pool has been started, end is not less than start, grain is
+ * positive, fn is not NULL
+ *
+ * Postconditions: Every piece has been handed to fn and finished, and no
+ * worker is still looking for more
+ *
+ * @param pool Pool to run on
+ * @param start First number of the range
+ * @param end Last number of the range
+ * @param grain Smallest piece handed to fn
+ * @param fn Function to run on each piece
+ * @param arg Argument passed to fn
+ * @return true if every piece returned true, false otherwise
+ */
+bool pool_run(struct pool *pool, uint64_t start, uint64_t end, uint64_t grain,
+		pool_fn fn, void *arg);
+
+/**
+ * @brief Stops the worker threads and releases the pool
+ *
+ * Preconditions: pool has been started and is not running a range
+ *
+ * Postconditions: The workers have exited and the pool's resources have been
+ * released
+ *
+ * @param pool Pool to stop
+ */
+void pool_destroy(struct pool *pool);
+
+#endif // POOL_H
@@ -0,0 +1,148 @@
+/**
+ * @file prefilter.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the cheap checks that reject candidates before they reach a
+ * divisor-sum kernel.
+ *
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prefilter.h"
+
+/// Largest length of a stage name
+#define PREFILTER_NAME 16
+
+/// Names used to select stages, indexed by enum prefilter_stage
+static const char *stage_names[] = { "odd", "digit", "root", "euclid" };
+
+/// Descriptions of the stages, indexed by enum prefilter_stage
+static const char *stage_help[] = {
+	"odd numbers",
+	"even numbers above 6 not ending in 6 or 8",
+	"even numbers above 6 whose digital root is not 1",
+	"even numbers not of the form 2^k * (2^(k+1) - 1)"
+};
+
+bool prefilter_parse(const char *list, unsigned int *stages) {
+	char name[PREFILTER_NAME];
+	const char *end;
+	size_t length;
+	unsigned int i;
+
+	assert(list != NULL);
+	assert(stages != NULL);
+
+	if (strcmp(list, "all") == 0) {
+		*stages = PREFILTER_ALL;
+		return true;
+	}
+
+	if (strcmp(list, "none") == 0) {
+		*stages = 0;
+		return true;
+	}
+
+	*stages = 0;
+	while (*list != '\0') {
+		end = strchr(list, ',');
+		length = (end == NULL) ? strlen(list) : (size_t)(end - list);
+		if (length >= PREFILTER_NAME) {
+			return false;
+		}
+
+		memcpy(name, list, length);
+		name[length] = '\0';
+
+		for (i = 0; i < PREFILTER_STAGES; i++) {
+			if (strcmp(stage_names[i], name) == 0) {
+				*stages |= 1U << i;
+				break;
+			}
+		}
+
+		if (i == PREFILTER_STAGES) {
+			return false;
+		}
+
+		list += length;
+		if (*list == ',') {
+			list++;
+		}
+	}
+
+	return true;
+}
+
+const char *prefilter_name(enum prefilter_stage stage) {
+	assert(stage < PREFILTER_STAGES);
+
+	return stage_names[stage];
+}
+
+const char *prefilter_help(enum prefilter_stage stage) {
+	assert(stage < PREFILTER_STAGES);
+
+	return stage_help[stage];
+}
+
+bool prefilter_pass(uint64_t n, unsigned int stages, uint64_t *rejected) {
+	unsigned int k;
+
+	assert(rejected != NULL);
+
+	if (((stages & (1U << PREFILTER_ODD)) != 0) && ((n & 1) == 1)) {
+		rejected[PREFILTER_ODD]++;
+		return false;
+	}
+
+	// 6 is the one even perfect number the decimal rules skip
+	if ((n <= 6) || ((n & 1) == 1)) {
+		return true;
+	}
+
+	if (((stages & (1U << PREFILTER_DIGIT)) != 0) && (n % 10 != 6) && (n % 10 != 8)) {
+		rejected[PREFILTER_DIGIT]++;
+		return false;
+	}
+
+	if (((stages & (1U << PREFILTER_ROOT)) != 0) && (n % 9 != 1)) {
+		rejected[PREFILTER_ROOT]++;
+		return false;
+	}
+
+	// Euclid-Euler: every even perfect number is 2^k * (2^(k+1) - 1)
+	if ((stages & (1U << PREFILTER_EUCLID)) != 0) {
+		k = __builtin_ctzll(n);
+		if ((k >= 32) || ((n >> k) != ((uint64_t)2 << k) - 1)) {
+			rejected[PREFILTER_EUCLID]++;
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file prefilter.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the cheap checks that reject candidates before they reach a
+ * divisor-sum kernel.
+ *
+ */
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Also included by the C++ kernels
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Prefilter stages, in the order they are tried
+ */
+enum prefilter_stage {
+	PREFILTER_ODD,		///< Rejects odd n, since no odd perfect number is below 10^1500
+	PREFILTER_DIGIT,	///< Rejects even n > 6 that do not end in 6 or 8
+	PREFILTER_ROOT,		///< Rejects even n > 6 whose digital root is not 1
+	PREFILTER_EUCLID,	///< Rejects even n not of the Euclid-Euler form 2^k * (2^(k+1) - 1)
+	PREFILTER_STAGES	///< Number of stages
+};
+
+/// Every prefilter stage
+#define PREFILTER_ALL ((1U << PREFILTER_STAGES) - 1)
+
+/// Stages enabled unless asked otherwise. The euclid stage leaves so few
+/// candidates that ranges skip the sieve, which then neither runs nor
+/// classifies the numbers it would have summed.
+#define PREFILTER_DEFAULT (PREFILTER_ALL & ~(1U << PREFILTER_EUCLID))
+
+/**
+ * @brief Parses a comma separated list of stage names
+ *
+ * "all" and "none" select every stage and no stage.
+ *
+ * Preconditions: list is not NULL, stages is not NULL
+ *
+ * Postconditions: stages holds a bit for each stage listed if every name was
+ * valid
+ *
+ * @param list Stage names separated by commas
+ * @param stages Set to the mask of stages listed
+ * @return true if every name was valid, false otherwise
+ */
+bool prefilter_parse(const char *list, unsigned int *stages);
+
+/**
+ * @brief Gets the name of a stage
+ *
+ * Preconditions: stage is less than PREFILTER_STAGES
+ *
+ * Postconditions:
+ *
+ * @param stage Stage to name
+ * @return Name of the stage
+ */
+const char *prefilter_name(enum prefilter_stage stage);
+
+/**
+ * @brief Describes what a stage rejects, for usage messages
+ *
+ * Preconditions: stage is less than PREFILTER_STAGES
+ *
+ * Postconditions:
+ *
+ * @param stage Stage to describe
+ * @return One line description of the stage
+ */
+const char *prefilter_help(enum prefilter_stage stage);
+
+/**
+ * @brief Checks a candidate against the enabled stages
+ *
+ * Every stage only rejects numbers that can not be perfect, so a candidate
+ * that fails one does not need a kernel. Each stage costs a few instructions.
+ *
+ * Preconditions: rejected is not NULL and has PREFILTER_STAGES entries
+ *
+ * Postconditions: The counter of the stage that rejected n, if any, has been
+ * incremented
+ *
+ * @param n Candidate to check
+ * @param stages Mask of enabled stages
+ * @param rejected Rejection counter for each stage
+ * @return true if n could be perfect, false if a stage rejected it
+ */
+bool prefilter_pass(uint64_t n, unsigned int stages, uint64_t *rejected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PREFILTER_H
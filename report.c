@@ -39,6 +39,7 @@
 #include <string.h>
 #include <unistd.h>
 #include "packets.h"
+#include "prefilter.h"
 #include "shmem.h"
 #include "sock.h"
 
@@ -219,9 +220,100 @@ bool sock_kill(int fd);
  * Postconditions:
  *
  * @param res Pointer to shared memory resource structure
- * @return Next untested number or -1 if all numbers have been tested
+ * @return Next untested number or 0 if all numbers have been tested
  */
-int next_test(struct shmem_res *res);
+uint64_t next_test(struct shmem_res *res);
+
+/**
+ * @brief Prints a perfect number
+ *
+ * Numbers found from a Mersenne exponent p are printed as 2^(p-1) * (2^p - 1),
+ * followed by their value when it fits in 64 bits.
+ *
+ * Preconditions: perfnum is not NULL
+ *
+ * Postconditions: The number has been printed
+ *
+ * @param perfnum Perfect number payload to print
+ */
+void print_perfnum(struct packet_perfnum *perfnum);
+
+/**
+ * @brief Prints a k-perfect number along with its k
+ *
+ * Preconditions: multiperfect is not NULL
+ *
+ * Postconditions: The number has been printed
+ *
+ * @param multiperfect k-perfect number payload to print
+ */
+void print_multiperfect(struct packet_multiperfect *multiperfect);
+
+/**
+ * @brief Prints an amicable pair
+ *
+ * Preconditions: amicable is not NULL
+ *
+ * Postconditions: The pair has been printed
+ *
+ * @param amicable Amicable pair payload to print
+ */
+void print_amicable(struct packet_amicable *amicable);
+
+/**
+ * @brief Prints how the pair kernel decided the candidates it tested
+ *
+ * Preconditions: stats is not NULL
+ *
+ * Postconditions: The counters have been printed if any are set
+ *
+ * @param stats Kernel counters to print
+ */
+void print_stats(struct kernel_stats *stats);
+
+/**
+ * @brief Prints how many candidates each prefilter stage rejected
+ *
+ * Preconditions: label is not NULL, rejected is not NULL and has
+ * PREFILTER_STAGES entries
+ *
+ * Postconditions: The counters have been printed if any are set
+ *
+ * @param label Text to start the line with
+ * @param rejected Rejection counter for each stage
+ */
+void print_rejected(const char *label, uint64_t *rejected);
+
+/**
+ * @brief Prints how the tested candidates split by abundancy
+ *
+ * Preconditions: label is not NULL
+ *
+ * Postconditions: The counters have been printed if any are set, along
+ * with the highest abundancy seen when peak_n is not zero
+ *
+ * @param label Text to start the line with
+ * @param abundant Number of candidates with sigma(n) > 2n
+ * @param deficient Number of candidates with sigma(n) < 2n
+ * @param perfect Number of candidates with sigma(n) == 2n
+ * @param peak_n Candidate with the highest abundancy, or 0 for none
+ * @param peak_sigma sigma(peak_n)
+ */
+void print_classified(const char *label, uint64_t abundant, uint64_t deficient,
+		uint64_t perfect, uint64_t peak_n, uint64_t peak_sigma);
+
+/**
+ * @brief Prints how many Mersenne exponents trial factoring ruled out
+ *
+ * Preconditions: label is not NULL
+ *
+ * Postconditions: The counters have been printed if any time was spent
+ *
+ * @param label Text to start the line with
+ * @param factored Exponents ruled out
+ * @param ns Nanoseconds spent trial factoring
+ */
+void print_factored(const char *label, uint64_t factored, uint64_t ns);
 
 /**
  * @brief Exits the program cleanly.
@@ -409,7 +501,16 @@ void pipe_report(int fd, pid_t manage) {
 		if (chars_read > 0) {
 			switch (packet.id) {
 			case PACKETID_PERFNUM:
-				printf("%d\n", packet.perfnum.perfnum);
+				print_perfnum(&packet.perfnum);
+				break;
+			case PACKETID_MULTIPERFECT:
+				print_multiperfect(&packet.multiperfect);
+				break;
+			case PACKETID_AMICABLE:
+				print_amicable(&packet.amicable);
+				break;
+			case PACKETID_STATS:
+				print_stats(&packet.stats.stats);
 				break;
 			case PACKETID_DONE:
 				printf("Computation complete\n");
@@ -477,8 +578,15 @@ int load_pid_file(char *path) {
 }
 
 void shmem_report(struct shmem_res *res) {
-	int total = 0;
-	int next;
+	struct packet_perfnum perfnum;
+	struct packet_multiperfect multiperfect;
+	uint64_t total = 0;
+	uint64_t abundant = 0;
+	uint64_t deficient = 0;
+	uint64_t perfect = 0;
+	uint64_t peak_n = 0;
+	uint64_t peak_sigma = 0;
+	uint64_t next;
 	bool first_proc = true;
 
 	assert(res != NULL);
@@ -486,7 +594,26 @@ void shmem_report(struct shmem_res *res) {
 	printf("Perfect numbers:\n");
 	for (int i = 0; i < NPERFNUMS; i++) {
 		if (res->perfect_numbers[i] != 0) {
-			printf("%d\n", res->perfect_numbers[i]);
+			// When searching exponents the list holds exponents
+			if (*res->search == SEARCH_EXPONENTS) {
+				perfnum.perfnum = 0;
+				perfnum.exponent = (unsigned int)res->perfect_numbers[i];
+			} else {
+				perfnum.perfnum = res->perfect_numbers[i];
+				perfnum.exponent = 0;
+			}
+			print_perfnum(&perfnum);
+		}
+	}
+
+	if (res->multiperfect[0].n != 0) {
+		printf("\nMultiperfect numbers:\n");
+		for (int i = 0; i < NMULTIPERFECT; i++) {
+			if (res->multiperfect[i].n != 0) {
+				multiperfect.n = res->multiperfect[i].n;
+				multiperfect.k = res->multiperfect[i].k;
+				print_multiperfect(&multiperfect);
+			}
 		}
 	}
 
@@ -497,18 +624,52 @@ void shmem_report(struct shmem_res *res) {
 				first_proc = false;
 			}
 
-			printf("compute (%d): tested %d, found %d\n", p->pid, p->tested, p->found);
+			printf("compute (%d): tested %llu, found %llu", p->pid,
+					(unsigned long long)p->tested, (unsigned long long)p->found);
+			if (p->cpu >= 0) {
+				printf(", CPU %d on node %d", p->cpu, p->node);
+			}
+			printf("\n");
+			if ((p->abundant_exits != 0) || (p->deficient_exits != 0)) {
+				printf("    stopped early: %llu abundant, %llu deficient, %llu full scans\n",
+						(unsigned long long)p->abundant_exits,
+						(unsigned long long)p->deficient_exits,
+						(unsigned long long)p->full_scans);
+			}
+			print_rejected("    prefiltered:", p->rejected);
+			print_classified("    classified:", p->abundant, p->deficient, p->perfect,
+					p->peak_n, p->peak_sigma);
+			if (p->looked_up != 0) {
+				printf("    answered from table: %llu\n", (unsigned long long)p->looked_up);
+			}
+			print_factored("    trial factoring:", p->factored, p->factor_ns);
 			total += p->tested;
+			abundant += p->abundant;
+			deficient += p->deficient;
+			perfect += p->perfect;
+			// Compare sigma/n without dividing: a/b > c/d iff a*d > c*b
+			if ((p->peak_n != 0) && ((peak_n == 0) ||
+					((unsigned __int128)p->peak_sigma * peak_n >
+					 (unsigned __int128)peak_sigma * p->peak_n))) {
+				peak_n = p->peak_n;
+				peak_sigma = p->peak_sigma;
+			}
 		}
 	}
 
+	if (first_proc == false) {
+		printf("\n");
+		print_classified("Classified:", abundant, deficient, perfect, peak_n, peak_sigma);
+	}
+
 	next = next_test(res);
 
-	if (next == -1) {
+	if (next == 0) {
 		printf("\nTesting complete\n");
 	} else {
-		printf("\n%d tested, %d remaining\n", total, *res->limit - total);
-		printf("Next untested integer: %d\n", next);
+		printf("\n%llu tested, %llu remaining\n", (unsigned long long)total,
+				(unsigned long long)(*res->limit - total));
+		printf("Next untested integer: %llu\n", (unsigned long long)next);
 	}
 }
 
@@ -575,7 +736,16 @@ void sock_report(int fd) {
 		if (bytes_read > 0) {
 			switch (p.id) {
 			case PACKETID_PERFNUM:
-				printf("%d\n", p.perfnum.perfnum);
+				print_perfnum(&p.perfnum);
+				break;
+			case PACKETID_MULTIPERFECT:
+				print_multiperfect(&p.multiperfect);
+				break;
+			case PACKETID_AMICABLE:
+				print_amicable(&p.amicable);
+				break;
+			case PACKETID_STATS:
+				print_stats(&p.stats.stats);
 				break;
 			case PACKETID_DONE:
 				printf("Computation complete\n");
@@ -619,21 +789,126 @@ bool sock_kill(int fd) {
 	return true;
 }
 
-int next_test(struct shmem_res *res) {
+uint64_t next_test(struct shmem_res *res) {
+	uint8_t *last;
+
 	assert(res != NULL);
 
-	// Loop over each byte in the bitmap
-	// Will actually test until the end of the byte if manage was given a limit that was
-	// not a power of two
-	for (uint8_t *addr = res->bitmap; addr < (uint8_t *)res->perfect_numbers; addr++) {
+	// Loop over each byte holding a number up to the limit; the bits past it
+	// are already set
+	last = res->bitmap + (*res->limit - 1) / 8;
+	for (uint8_t *addr = res->bitmap; addr <= last; addr++) {
 		for (int i = 0; i < 8; i++) {
 			if (BIT(*addr, i) == 0) {
-				return ((addr - res->bitmap) * 8) + i + 1;
+				return ((uint64_t)(addr - res->bitmap) * 8) + i + 1;
 			}
 		}
 	}
 
-	return -1;
+	return 0;
+}
+
+void print_perfnum(struct packet_perfnum *perfnum) {
+	unsigned int p;
+
+	assert(perfnum != NULL);
+
+	p = perfnum->exponent;
+	if (p == 0) {
+		printf("%llu\n", (unsigned long long)perfnum->perfnum);
+	} else if (p <= 32) {
+		// 2^(p-1) * (2^p - 1) has 2p - 1 bits, so it fits up to p = 32
+		printf("2^%u * (2^%u - 1) = %llu\n", p - 1, p,
+				((1ULL << (p - 1)) * ((1ULL << p) - 1)));
+	} else {
+		printf("2^%u * (2^%u - 1)\n", p - 1, p);
+	}
+}
+
+void print_multiperfect(struct packet_multiperfect *multiperfect) {
+	assert(multiperfect != NULL);
+
+	printf("%llu (%u-perfect)\n", (unsigned long long)multiperfect->n, multiperfect->k);
+}
+
+void print_amicable(struct packet_amicable *amicable) {
+	assert(amicable != NULL);
+
+	printf("%llu, %llu (amicable)\n", (unsigned long long)amicable->a,
+			(unsigned long long)amicable->b);
+}
+
+void print_stats(struct kernel_stats *stats) {
+	assert(stats != NULL);
+
+	print_rejected("Prefiltered:", stats->rejected);
+	print_classified("Classified:", stats->abundant, stats->deficient, stats->perfect,
+			stats->peak_n, stats->peak_sigma);
+	if (stats->looked_up != 0) {
+		printf("Answered from table: %llu\n", (unsigned long long)stats->looked_up);
+	}
+	print_factored("Trial factoring:", stats->factored, stats->factor_ns);
+
+	if ((stats->abundant_exits == 0) && (stats->deficient_exits == 0)) {
+		// Nothing stopped early, likely a kernel without the cutoff
+		return;
+	}
+
+	printf("Stopped early: %llu abundant, %llu deficient, %llu full scans\n",
+			(unsigned long long)stats->abundant_exits,
+			(unsigned long long)stats->deficient_exits,
+			(unsigned long long)stats->full_scans);
+	printf("Trial divisions skipped: %llu\n", (unsigned long long)stats->skipped);
+}
+
+void print_rejected(const char *label, uint64_t *rejected) {
+	uint64_t total = 0;
+	int i;
+
+	assert(label != NULL);
+	assert(rejected != NULL);
+
+	for (i = 0; i < PREFILTER_STAGES; i++) {
+		total += rejected[i];
+	}
+
+	if (total == 0) {
+		return;
+	}
+
+	printf("%s", label);
+	for (i = 0; i < PREFILTER_STAGES; i++) {
+		printf(" %llu %s%s", (unsigned long long)rejected[i], prefilter_name(i),
+				(i < PREFILTER_STAGES - 1) ? "," : "\n");
+	}
+}
+
+void print_classified(const char *label, uint64_t abundant, uint64_t deficient,
+		uint64_t perfect, uint64_t peak_n, uint64_t peak_sigma) {
+	assert(label != NULL);
+
+	if ((abundant == 0) && (deficient == 0) && (perfect == 0)) {
+		return;
+	}
+
+	printf("%s %llu abundant, %llu deficient, %llu perfect\n", label,
+			(unsigned long long)abundant, (unsigned long long)deficient,
+			(unsigned long long)perfect);
+	if (peak_n != 0) {
+		printf("%s highest abundancy %.6f at %llu\n", label,
+				(double)peak_sigma / (double)peak_n, (unsigned long long)peak_n);
+	}
+}
+
+void print_factored(const char *label, uint64_t factored, uint64_t ns) {
+	assert(label != NULL);
+
+	if (ns == 0) {
+		return;
+	}
+
+	printf("%s %llu exponents ruled out in %.3f s\n", label,
+			(unsigned long long)factored, ns / 1e9);
 }
 
 void handle_signal(int sig) {
@@ -7,6 +7,7 @@ REMOVEDIR = rm -rf
 
 SRC =	report.c \
 		packets.c \
+		prefilter.c \
 		shmem.c \
 		sock.c \
 
@@ -33,13 +33,86 @@
 #include <stdio.h>
 #include "shmem.h"
 
+/**
+ * @brief Computes the size of the bitmap
+ *
+ * The size is rounded up to a multiple of 8 bytes so that everything after the
+ * bitmap stays aligned.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param limit Highest number to test
+ * @return Size of the bitmap in bytes
+ */
+static size_t bitmap_size(uint64_t limit);
+
+/**
+ * @brief Computes the size of the prime table
+ *
+ * The size is rounded up to a multiple of 8 bytes so that the bitmap after it
+ * stays aligned.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param nprimes Number of entries in the prime table
+ * @return Size of the prime table in bytes
+ */
+static size_t primes_size(uint64_t nprimes);
+
+size_t shmem_size(uint64_t limit, uint64_t nprimes) {
+	size_t perfnums_size;
+	size_t multiperfect_size;
+	size_t processes_size;
+
+	assert(limit > 0);
+
+	perfnums_size = NPERFNUMS * sizeof(uint64_t);
+	multiperfect_size = NMULTIPERFECT * sizeof(struct multiperfect);
+	processes_size = NPROCS * sizeof(struct process);
+
+	return (2 * sizeof(uint64_t)) + sizeof(pid_t) + sizeof(int) + (2 * sizeof(sem_t)) +
+		primes_size(nprimes) + bitmap_size(limit) + perfnums_size + multiperfect_size +
+		processes_size;
+}
+
+static size_t bitmap_size(uint64_t limit) {
+	return ((limit / 8 + 1) + 7) & ~(size_t)7;
+}
+
+static size_t primes_size(uint64_t nprimes) {
+	return ((nprimes * sizeof(uint32_t)) + 7) & ~(size_t)7;
+}
+
+void shmem_map(struct shmem_res *res, void *addr, uint64_t limit, uint64_t nprimes) {
+	assert(res != NULL);
+	assert(addr != NULL);
+
+	res->addr = addr;
+	res->limit = res->addr;
+	res->nprimes = res->limit + 1;
+	res->manage = (pid_t *)(res->nprimes + 1);
+	res->search = (int *)(res->manage + 1);
+	res->bitmap_sem = (sem_t *)(res->search + 1);
+
+	// The prime table follows the fixed size header, then the bitmap
+	res->primes = (uint32_t *)(res->bitmap_sem + 1);
+	res->bitmap = (uint8_t *)res->primes + primes_size(nprimes);
+	res->perfect_numbers_sem = (sem_t *)(res->bitmap + bitmap_size(limit));
+	res->perfect_numbers = (uint64_t *)(res->perfect_numbers_sem + 1);
+	res->multiperfect = (struct multiperfect *)(res->perfect_numbers + NPERFNUMS);
+	res->processes = (struct process *)(res->multiperfect + NMULTIPERFECT);
+	res->end = res->processes + NPROCS;
+}
+
 bool shmem_load(struct shmem_res *res) {
 	int shmem_fd;
-	int bitmap_size;
-	int perfnums_size;
-	int processes_size;
-	int total_size;
-	int limit;
+	size_t total_size;
+	uint64_t limit;
+	uint64_t nprimes;
 	void *addr;
 
 	assert(res != NULL);
@@ -51,19 +124,20 @@ bool shmem_load(struct shmem_res *res) {
 		return false;
 	}
 
-	if (read(shmem_fd, &limit, sizeof(int)) == -1) {
+	if (read(shmem_fd, &limit, sizeof(limit)) != sizeof(limit)) {
 		perror("Could not read limit");
 		return false;
 	}
 
-	bitmap_size = limit / 8 + 1;
-	perfnums_size = NPERFNUMS * sizeof(int);
-	processes_size = NPROCS * sizeof(struct process);
-	total_size = sizeof(pid_t) + sizeof(int) + (2 * sizeof(sem_t)) + bitmap_size +
-		perfnums_size + processes_size;
+	if (read(shmem_fd, &nprimes, sizeof(nprimes)) != sizeof(nprimes)) {
+		perror("Could not read prime count");
+		return false;
+	}
+
+	total_size = shmem_size(limit, nprimes);
 
 	// Check that the size of the shared memory object is the correct size
-	if (total_size != lseek(shmem_fd, 0, SEEK_END)) {
+	if ((off_t)total_size != lseek(shmem_fd, 0, SEEK_END)) {
 		fprintf(stderr, "Shared memory object is invalid\n");
 		return false;
 	}
@@ -76,17 +150,7 @@ bool shmem_load(struct shmem_res *res) {
 		return false;
 	}
 
-	res->addr = addr;
-	res->limit = res->addr;
-	res->manage = res->limit + 1;
-	res->bitmap_sem = (sem_t *)(res->manage + 1);
-	
-	// limit is a single integer, so bitmap is one int past
-	res->bitmap = (uint8_t *)(res->bitmap_sem + 1);
-	res->perfect_numbers_sem = (sem_t *)(res->bitmap + bitmap_size);
-	res->perfect_numbers = (int *)(res->perfect_numbers_sem + 1);
-	res->processes = (struct process *)(res->perfect_numbers + NPERFNUMS);
-	res->end = res->processes + NPROCS;
+	shmem_map(res, addr, limit, nprimes);
 
 	return true;
 }
@@ -34,6 +34,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <unistd.h>
+#include "prefilter.h"
 
 /// Macro to get the value of a specific bit
 #define BIT(byte, bit) ((byte >> bit) & 1)
@@ -50,6 +51,9 @@
 /// Maximum number of perfect numbers to store in shared memory
 #define NPERFNUMS 20
 
+/// Maximum number of k-perfect numbers (k >= 3) to store in shared memory
+#define NMULTIPERFECT 40
+
 /// Maximum number of processes to track in shared memory
 #define NPROCS 20
 
@@ -58,8 +62,30 @@
  */
 struct process {
 	pid_t pid;
-	int found;
-	int tested;
+	uint64_t found;
+	uint64_t tested;
+	uint64_t abundant_exits;
+	uint64_t deficient_exits;
+	uint64_t full_scans;
+	uint64_t rejected[PREFILTER_STAGES];
+	uint64_t abundant;
+	uint64_t deficient;
+	uint64_t perfect;
+	uint64_t peak_n;
+	uint64_t peak_sigma;
+	uint64_t looked_up;
+	uint64_t factored;
+	uint64_t factor_ns;
+	int cpu;
+	int node;
+};
+
+/**
+ * k-perfect number entry, unused while n is 0
+ */
+struct multiperfect {
+	uint64_t n;
+	uint64_t k;
 };
 
 /**
@@ -67,16 +93,48 @@ struct process {
  */
 struct shmem_res {
 	void *addr;
-	int *limit;
+	uint64_t *limit;
+	uint64_t *nprimes;
 	pid_t *manage;
+	int *search;
 	sem_t *bitmap_sem;
+	uint32_t *primes;
 	uint8_t *bitmap;
 	sem_t *perfect_numbers_sem;
-	int *perfect_numbers;
+	uint64_t *perfect_numbers;
+	struct multiperfect *multiperfect;
 	struct process *processes;
 	void *end;
 };
 
+/**
+ * @brief Computes the size of the shared memory object
+ *
+ * Preconditions: limit is positive
+ *
+ * Postconditions:
+ *
+ * @param limit Highest number to test
+ * @param nprimes Number of entries in the prime table
+ * @return Size of the shared memory object in bytes
+ */
+size_t shmem_size(uint64_t limit, uint64_t nprimes);
+
+/**
+ * @brief Sets resource locations in res for a mapped shared memory object
+ *
+ * Preconditions: res is not NULL, addr points to a mapping of
+ * shmem_size(limit, nprimes) bytes
+ *
+ * Postconditions: Resource locations have been set in res
+ *
+ * @param res Pointer to shared memory resource strucure
+ * @param addr Address the shared memory object is mapped at
+ * @param limit Highest number to test
+ * @param nprimes Number of entries in the prime table
+ */
+void shmem_map(struct shmem_res *res, void *addr, uint64_t limit, uint64_t nprimes);
+
 /**
  * @brief Opens and mmaps shared memory object
  *
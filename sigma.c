@@ -0,0 +1,883 @@
+/**
+ * @file sigma.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the divisor-sum kernels used by compute to test candidates.
+ *
+ */
+#include <assert.h>
+#include <math.h> // For sqrt()
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "factor.h"
+#include "sigma.h"
+
+/// The maximum number of divisors to store in the reference kernel
+#define MAX_DIVISORS 10000
+
+/// Adding and subtracting this rounds a double below 2^51 to an integer
+#define ROUND_MAGIC 6755399441055744.0
+
+/// Below this, double precision division is off by at most one and is much
+/// cheaper than 64-bit integer division
+#define FLOAT_DIV_LIMIT ((uint64_t)1 << 52)
+
+/// The wheel kernel divides out the primes of this modulus, 2 * 3 * 5 * 7, and
+/// then only tries divisors coprime to it
+#define WHEEL_MODULUS 210
+
+/// Residues coprime to WHEEL_MODULUS, 48 of every 210 numbers
+#define WHEEL_SPOKES 48
+
+/// Below this, every lane of the batch kernel is exact in double precision
+#define BATCH_EXACT_LIMIT ((uint64_t)1 << 50)
+
+/// Vector kernels can only be built for, and detected on, x86
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_ISA 1
+#else
+#define HAVE_X86_ISA 0
+#endif
+
+/// List of kernels that can be selected by name
+static const struct kernel kernels[] = {
+	{ "sieve", is_perfect_number, sigma_sieve, NULL, NULL },
+	{ "spf", spf_is_perfect, spf_sieve, NULL, spf_init },
+	{ "prime", prime_is_perfect, NULL, NULL, prime_init },
+	{ "wheel", wheel_is_perfect, NULL, NULL, NULL },
+	{ "rho", rho_is_perfect, NULL, NULL, NULL },
+	{ "batch", is_perfect_number, NULL, is_perfect_batch, NULL },
+	{ "pair", is_perfect_number, NULL, NULL, NULL },
+	{ "naive", is_perfect_number_naive, NULL, NULL, NULL },
+	{ "cxx", cxx_is_perfect, cxx_sieve, NULL, NULL },
+};
+
+/// Number of entries in kernels
+#define NKERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/// Names used to select an instruction set, indexed by enum isa
+static const char *isa_names[] = { "scalar", "avx2", "avx512" };
+
+/// Number of entries in isa_names
+#define NISAS (sizeof(isa_names) / sizeof(isa_names[0]))
+
+__thread struct kernel_stats kernel_stats;
+
+/// Smallest prime factor of each number, 0 for primes
+static uint32_t *spf_table = NULL;
+
+/// Largest number covered by spf_table
+static uint64_t spf_limit = 0;
+
+/// Primes used by prime_is_perfect(), in increasing order
+static const uint32_t *prime_table = NULL;
+
+/// prime_table if prime_init() allocated it, NULL if it was attached
+static uint32_t *prime_owned = NULL;
+
+/// Number of entries in prime_table
+static uint64_t prime_count = 0;
+
+/// Largest number prime_table can factor
+static uint64_t prime_limit = 0;
+
+/// Primes dividing WHEEL_MODULUS
+static const uint32_t wheel_primes[] = { 2, 3, 5, 7 };
+
+/// Number of entries in wheel_primes
+#define NWHEEL_PRIMES (sizeof(wheel_primes) / sizeof(wheel_primes[0]))
+
+/// Gaps between successive numbers coprime to WHEEL_MODULUS, starting from 11
+static const uint8_t wheel_gaps[WHEEL_SPOKES] = {
+	2, 4, 2, 4, 6, 2, 6, 4, 2, 4, 6, 6, 2, 6, 4, 2, 6, 4, 6, 8, 4, 2, 4, 2,
+	4, 8, 6, 4, 6, 2, 4, 6, 2, 6, 6, 4, 2, 4, 6, 2, 6, 4, 2, 4, 2, 10, 2, 10
+};
+
+/**
+ * @brief Computes the integer square root
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to take the root of
+ * @return The largest r such that r * r <= n
+ */
+static uint64_t isqrt(uint64_t n);
+
+/**
+ * @brief Pair kernel for candidates below 2^32, where division is cheapest
+ *
+ * Preconditions: n is at least 2, root is isqrt(n)
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Number to test
+ * @param root Integer square root of n
+ * @return true if n is a perfect number, false otherwise
+ */
+static bool pair_scan32(uint32_t n, uint32_t root);
+
+/**
+ * @brief Pair kernel for candidates of any size
+ *
+ * Below FLOAT_DIV_LIMIT the quotient comes from double precision division and
+ * a single correction step instead of a 64-bit divide. The running sum is
+ * kept as what is left to reach n, so it cannot overflow near 2^64.
+ *
+ * Preconditions: n is at least 2, root is isqrt(n)
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Number to test
+ * @param root Integer square root of n
+ * @return true if n is a perfect number, false otherwise
+ */
+static bool pair_scan64(uint64_t n, uint64_t root);
+
+/**
+ * @brief Divides every factor p out of m and multiplies sigma(p^k) into sigma
+ *
+ * Preconditions: m is not NULL, sigma is not NULL, p is at least 2 and
+ * divides m
+ *
+ * Postconditions: p no longer divides m
+ *
+ * @param m Part of the candidate not factored yet
+ * @param p Prime factor of m
+ * @param sigma Divisor sum of the part of the candidate factored so far
+ */
+static void divide_out(uint64_t *m, uint64_t p, unsigned __int128 *sigma);
+
+/**
+ * @brief Binds the batch kernel for this CPU, then tests a batch with it
+ *
+ * Stands in for the batch kernel until kernel_dispatch() is called, so the
+ * kernels work without any setup.
+ *
+ * Preconditions: n is not NULL, count is at most KERNEL_BATCH
+ *
+ * Postconditions: A batch kernel has been bound
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number
+ */
+static unsigned int batch_resolve(const uint64_t *n, unsigned int count);
+
+/// Batch kernel bound by kernel_dispatch()
+static batch_fn batch_impl = batch_resolve;
+
+#if HAVE_X86_ISA
+// Without AVX there is no 64-bit lane select, and GCC's scalar stand-in is
+// slower than the scalar kernel, so there is no SSE build
+#define BATCH_NAME is_perfect_batch_avx2
+#define BATCH_TARGET "avx2"
+#define BATCH_BYTES 32
+#include "sigma_batch.h"
+
+#define BATCH_NAME is_perfect_batch_avx512
+#define BATCH_TARGET "avx512f"
+#define BATCH_BYTES 64
+#include "sigma_batch.h"
+#endif
+
+bool is_perfect_number(uint64_t n) {
+	uint64_t root;
+
+	if (n < 2) {
+		// 1 has no proper divisors
+		return false;
+	}
+
+	root = isqrt(n);
+
+	if (n <= UINT32_MAX) {
+		return pair_scan32(n, root);
+	}
+
+	return pair_scan64(n, root);
+}
+
+static uint64_t isqrt(uint64_t n) {
+	uint64_t root = (uint64_t)sqrt((double)n);
+
+	// The double may be off by one either way
+	while ((root > 0) && (root > n / root)) {
+		root--;
+	}
+	while ((root + 1) <= n / (root + 1)) {
+		root++;
+	}
+
+	return root;
+}
+
+static bool pair_scan32(uint32_t n, uint32_t root) {
+	uint32_t rest = n - 1; // 1 divides everything
+	uint32_t add;
+	uint32_t q;
+	uint32_t i;
+
+	for (i = 2; i <= root; i++) {
+		q = n / i;
+
+		// d + n / d shrinks as d grows towards the root, so no pair from here
+		// on adds more than i + q
+		if ((uint64_t)(root - i + 1) * (i + q) < rest) {
+			kernel_stats.deficient_exits++;
+			kernel_stats.deficient++;
+			kernel_stats.skipped += root - i + 1;
+			return false;
+		}
+
+		if ((n % i) == 0) {
+			// Don't count the square root of a perfect square twice
+			add = (q != i) ? (i + q) : i;
+
+			if (add > rest) {
+				kernel_stats.abundant_exits++;
+				kernel_stats.abundant++;
+				kernel_stats.skipped += root - i;
+				return false;
+			}
+
+			rest -= add;
+		}
+	}
+
+	kernel_stats.full_scans++;
+
+	// An abundant n would have stopped early, so rest is never negative
+	if (rest == 0) {
+		kernel_stats.perfect++;
+	} else {
+		kernel_stats.deficient++;
+	}
+
+	return (rest == 0);
+}
+
+static bool pair_scan64(uint64_t n, uint64_t root) {
+	bool fast = (n < FLOAT_DIV_LIMIT);
+	uint64_t rest = n - 1; // 1 divides everything
+	uint64_t add;
+	uint64_t q;
+	uint64_t r;
+	uint64_t i;
+
+	for (i = 2; i <= root; i++) {
+		if (fast == true) {
+			q = (uint64_t)((double)n / (double)i);
+			r = n - q * i;
+			if ((int64_t)r < 0) {
+				q--;
+				r += i;
+			} else if (r >= i) {
+				q++;
+				r -= i;
+			}
+		} else {
+			q = n / i;
+			r = n % i;
+		}
+
+		// d + n / d shrinks as d grows towards the root, so no pair from here
+		// on adds more than i + q
+		if ((unsigned __int128)(root - i + 1) * (i + q) < rest) {
+			kernel_stats.deficient_exits++;
+			kernel_stats.deficient++;
+			kernel_stats.skipped += root - i + 1;
+			return false;
+		}
+
+		if (r == 0) {
+			// Don't count the square root of a perfect square twice
+			add = (q != i) ? (i + q) : i;
+
+			if (add > rest) {
+				kernel_stats.abundant_exits++;
+				kernel_stats.abundant++;
+				kernel_stats.skipped += root - i;
+				return false;
+			}
+
+			rest -= add;
+		}
+	}
+
+	kernel_stats.full_scans++;
+
+	// An abundant n would have stopped early, so rest is never negative
+	if (rest == 0) {
+		kernel_stats.perfect++;
+	} else {
+		kernel_stats.deficient++;
+	}
+
+	return (rest == 0);
+}
+
+bool is_perfect_number_naive(uint64_t n) {
+	uint64_t divisors[MAX_DIVISORS];
+	unsigned int n_divisors = 0;
+	uint64_t sum = 0;
+	uint64_t i;
+
+	for (i = 1; i < n; i++) {
+		if ((n % i) == 0) {
+			// Is a divisor
+			divisors[n_divisors++] = i;
+		}
+	}
+
+	for (i = 0; i < n_divisors; i++) {
+		sum += divisors[i];
+	}
+
+	return (sum == n);
+}
+
+void kernel_classify(uint64_t n, unsigned __int128 sigma) {
+	assert(n > 0);
+
+	if (sigma > 2 * (unsigned __int128)n) {
+		kernel_stats.abundant++;
+	} else if (sigma < 2 * (unsigned __int128)n) {
+		kernel_stats.deficient++;
+	} else {
+		kernel_stats.perfect++;
+	}
+
+	// sigma(n) < 7n below 2^64, so only n past 2^61 can miss out here
+	if (sigma <= UINT64_MAX) {
+		kernel_peak(&kernel_stats.peak_n, &kernel_stats.peak_sigma, n, sigma);
+	}
+}
+
+void kernel_peak(uint64_t *peak_n, uint64_t *peak_sigma, uint64_t n, uint64_t sigma) {
+	assert(peak_n != NULL);
+	assert(peak_sigma != NULL);
+
+	if (n == 0) {
+		return;
+	}
+
+	if ((*peak_n == 0) ||
+			((unsigned __int128)sigma * *peak_n > (unsigned __int128)*peak_sigma * n)) {
+		*peak_n = n;
+		*peak_sigma = sigma;
+	}
+}
+
+void kernel_stats_add(struct kernel_stats *total, const struct kernel_stats *stats) {
+	unsigned int i;
+
+	assert(total != NULL);
+	assert(stats != NULL);
+
+	total->abundant_exits += stats->abundant_exits;
+	total->deficient_exits += stats->deficient_exits;
+	total->full_scans += stats->full_scans;
+	total->skipped += stats->skipped;
+	for (i = 0; i < PREFILTER_STAGES; i++) {
+		total->rejected[i] += stats->rejected[i];
+	}
+	total->abundant += stats->abundant;
+	total->deficient += stats->deficient;
+	total->perfect += stats->perfect;
+	kernel_peak(&total->peak_n, &total->peak_sigma, stats->peak_n, stats->peak_sigma);
+	total->looked_up += stats->looked_up;
+	total->factored += stats->factored;
+	total->factor_ns += stats->factor_ns;
+}
+
+unsigned int is_perfect_batch(const uint64_t *n, unsigned int count) {
+	return batch_impl(n, count);
+}
+
+static unsigned int batch_resolve(const uint64_t *n, unsigned int count) {
+	kernel_dispatch(isa_detect());
+
+	return batch_impl(n, count);
+}
+
+unsigned int is_perfect_batch_scalar(const uint64_t *n, unsigned int count) {
+	unsigned int mask = 0;
+	unsigned int i;
+
+	assert(n != NULL);
+	assert(count <= KERNEL_BATCH);
+
+	for (i = 0; i < count; i++) {
+		if (is_perfect_number(n[i]) == true) {
+			mask |= 1U << i;
+		}
+	}
+
+	return mask;
+}
+
+void sigma_sieve(uint64_t *sums, uint64_t start, unsigned int count) {
+	uint64_t end = start + count - 1;
+	uint64_t square;
+	uint64_t m;
+	uint64_t q;
+	uint64_t d;
+
+	assert(sums != NULL);
+	assert(start > 0);
+	assert(count > 0);
+	assert(end < SIEVE_LIMIT);
+
+	memset(sums, 0, count * sizeof(uint64_t));
+
+	for (d = 1; (square = d * d) <= end; d++) {
+		// Smaller divisors of m were counted with their cofactors, so only
+		// visit multiples at or above d * d
+		m = ((start + d - 1) / d) * d;
+		if (m <= square) {
+			m = square;
+			sums[m - start] += d;
+			m += d;
+		}
+
+		for (q = m / d; m <= end; m += d, q++) {
+			sums[m - start] += d + q;
+		}
+	}
+}
+
+bool spf_init(uint64_t limit) {
+	uint32_t *table;
+	uint64_t size;
+	uint64_t j;
+	uint64_t i;
+
+	if (limit <= spf_limit) {
+		return true;
+	}
+
+	if (limit > SPF_LIMIT) {
+		fprintf(stderr, "Smallest prime factor table can not reach %llu\n",
+				(unsigned long long)limit);
+		return false;
+	}
+
+	// Leave room to grow so ranges handed out one at a time rarely rebuild
+	size = spf_limit * 2;
+	if (size < limit) {
+		size = limit;
+	}
+	if (size > SPF_LIMIT) {
+		size = SPF_LIMIT;
+	}
+
+	table = (uint32_t *)calloc(size + 1, sizeof(uint32_t));
+	if (table == NULL) {
+		perror("Could not allocate smallest prime factor table");
+		return false;
+	}
+
+	for (i = 2; i * i <= size; i++) {
+		if (table[i] == 0) {
+			// i is prime, mark it on every multiple that has no smaller factor
+			for (j = i * i; j <= size; j += i) {
+				if (table[j] == 0) {
+					table[j] = i;
+				}
+			}
+		}
+	}
+
+	free(spf_table);
+	spf_table = table;
+	spf_limit = size;
+
+	return true;
+}
+
+uint64_t spf_sigma(uint64_t n) {
+	uint64_t sigma = 1;
+	uint64_t term;
+	uint64_t power;
+	uint64_t p;
+
+	assert(n > 0);
+	assert(n <= spf_limit);
+
+	while (n > 1) {
+		p = spf_table[n];
+		if (p == 0) {
+			// What remains is prime
+			p = n;
+		}
+
+		// sigma(p^k) = 1 + p + ... + p^k
+		term = 1;
+		power = 1;
+		do {
+			n /= p;
+			power *= p;
+			term += power;
+		} while ((n % p) == 0);
+
+		sigma *= term;
+	}
+
+	return sigma;
+}
+
+bool spf_is_perfect(uint64_t n) {
+	if ((n < 2) || (n > spf_limit)) {
+		return is_perfect_number(n);
+	}
+
+	return (spf_sigma(n) == 2 * n);
+}
+
+void spf_sieve(uint64_t *sums, uint64_t start, unsigned int count) {
+	unsigned int i;
+
+	assert(sums != NULL);
+	assert(start > 0);
+	assert(count > 0);
+
+	for (i = 0; i < count; i++) {
+		sums[i] = spf_sigma(start + i);
+	}
+}
+
+uint32_t *prime_build(uint64_t limit, uint64_t *count) {
+	uint32_t *primes;
+	uint8_t *composite;
+	uint64_t root;
+	uint64_t i;
+	uint64_t j;
+
+	assert(count != NULL);
+
+	root = isqrt(limit);
+
+	composite = calloc(root + 1, sizeof(uint8_t));
+	if (composite == NULL) {
+		perror("Could not allocate prime sieve");
+		return NULL;
+	}
+
+	*count = 0;
+	for (i = 2; i <= root; i++) {
+		if (composite[i] == 0) {
+			(*count)++;
+			for (j = i * i; j <= root; j += i) {
+				composite[j] = 1;
+			}
+		}
+	}
+
+	// Always return something that can be freed, even with no primes
+	primes = malloc((*count + 1) * sizeof(uint32_t));
+	if (primes == NULL) {
+		perror("Could not allocate prime table");
+		free(composite);
+		return NULL;
+	}
+
+	for (i = 2, j = 0; i <= root; i++) {
+		if (composite[i] == 0) {
+			primes[j++] = i;
+		}
+	}
+
+	free(composite);
+
+	return primes;
+}
+
+bool prime_init(uint64_t limit) {
+	uint32_t *table;
+	uint64_t count;
+	uint64_t size;
+
+	if (limit <= prime_limit) {
+		return true;
+	}
+
+	// Twice the root covers four times the limit
+	size = (prime_limit > UINT64_MAX / 4) ? UINT64_MAX : prime_limit * 4;
+	if (size < limit) {
+		size = limit;
+	}
+
+	table = prime_build(size, &count);
+	if (table == NULL) {
+		return false;
+	}
+
+	free(prime_owned);
+	prime_owned = table;
+	prime_table = table;
+	prime_count = count;
+	prime_limit = size;
+
+	return true;
+}
+
+void prime_attach(const uint32_t *primes, uint64_t count, uint64_t limit) {
+	assert((primes != NULL) || (count == 0));
+
+	free(prime_owned);
+	prime_owned = NULL;
+	prime_table = primes;
+	prime_count = count;
+	prime_limit = limit;
+}
+
+bool prime_is_perfect(uint64_t n) {
+	unsigned __int128 target = 2 * (unsigned __int128)n;
+	unsigned __int128 sigma = 1;
+	unsigned __int128 term;
+	uint64_t power;
+	uint64_t rest;
+	uint64_t m = n;
+	uint64_t i;
+	uint32_t p;
+
+	if ((n < 2) || (n > prime_limit)) {
+		return wheel_is_perfect(n);
+	}
+
+	for (i = 0; i < prime_count; i++) {
+		p = prime_table[i];
+		if ((uint64_t)p * p > m) {
+			break;
+		}
+
+		// 32-bit division is several times cheaper
+		rest = (m <= UINT32_MAX) ? (uint32_t)m % p : m % p;
+		if (rest != 0) {
+			continue;
+		}
+
+		// sigma(p^k) = 1 + p + ... + p^k
+		term = 1;
+		power = 1;
+		do {
+			m /= p;
+			power *= p;
+			term += power;
+		} while ((m % p) == 0);
+
+		sigma *= term;
+
+		// Whatever is left of m adds a factor of at least m + 1
+		if (sigma * ((m > 1) ? (m + 1) : 1) > target) {
+			kernel_stats.abundant_exits++;
+			kernel_stats.abundant++;
+			return false;
+		}
+	}
+
+	// No prime up to the root of m divides it, so m is 1 or prime
+	if (m > 1) {
+		sigma *= m + 1;
+	}
+
+	kernel_stats.full_scans++;
+	kernel_classify(n, sigma);
+
+	return (sigma == target);
+}
+
+bool wheel_is_perfect(uint64_t n) {
+	unsigned __int128 target = 2 * (unsigned __int128)n;
+	unsigned __int128 sigma = 1;
+	uint64_t rest;
+	uint64_t m = n;
+	uint64_t d;
+	unsigned int i;
+
+	if (n < 2) {
+		// 1 has no proper divisors
+		return false;
+	}
+
+	for (i = 0; i < NWHEEL_PRIMES; i++) {
+		if ((m % wheel_primes[i]) == 0) {
+			divide_out(&m, wheel_primes[i], &sigma);
+		}
+	}
+
+	// Whatever is left of m adds a factor of at least m + 1
+	if (sigma * ((m > 1) ? (m + 1) : 1) > target) {
+		kernel_stats.abundant_exits++;
+		kernel_stats.abundant++;
+		return false;
+	}
+
+	// Past 7 only the 48 residues coprime to 210 can be prime, which skips
+	// 77% of the divisors a plain scan would try
+	for (d = 11, i = 0; (unsigned __int128)d * d <= m;
+			d += wheel_gaps[i], i = (i + 1) % WHEEL_SPOKES) {
+		// 32-bit division is several times cheaper
+		rest = (m <= UINT32_MAX) ? (uint32_t)m % (uint32_t)d : m % d;
+		if (rest != 0) {
+			continue;
+		}
+
+		divide_out(&m, d, &sigma);
+
+		if (sigma * ((m > 1) ? (m + 1) : 1) > target) {
+			kernel_stats.abundant_exits++;
+			kernel_stats.abundant++;
+			return false;
+		}
+	}
+
+	// Nothing up to the root of m divides it, so m is 1 or prime
+	if (m > 1) {
+		sigma *= m + 1;
+	}
+
+	kernel_stats.full_scans++;
+	kernel_classify(n, sigma);
+
+	return (sigma == target);
+}
+
+static void divide_out(uint64_t *m, uint64_t p, unsigned __int128 *sigma) {
+	unsigned __int128 term = 1;
+	uint64_t power = 1;
+
+	assert(m != NULL);
+	assert(sigma != NULL);
+	assert(p >= 2);
+
+	// sigma(p^k) = 1 + p + ... + p^k
+	do {
+		*m /= p;
+		power *= p;
+		term += power;
+	} while ((*m % p) == 0);
+
+	*sigma *= term;
+}
+
+const struct kernel *kernel_find(const char *name) {
+	unsigned int i;
+
+	assert(name != NULL);
+
+	for (i = 0; i < NKERNELS; i++) {
+		if (strcmp(kernels[i].name, name) == 0) {
+			return &kernels[i];
+		}
+	}
+
+	return NULL;
+}
+
+const struct kernel *kernel_at(unsigned int i) {
+	if (i >= NKERNELS) {
+		return NULL;
+	}
+
+	return &kernels[i];
+}
+
+void kernel_list(void) {
+	unsigned int i;
+
+	for (i = 0; i < NKERNELS; i++) {
+		printf("%s ", kernels[i].name);
+	}
+	printf("\n");
+}
+
+enum isa isa_detect(void) {
+#if HAVE_X86_ISA
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f")) {
+		return ISA_AVX512;
+	}
+
+	if (__builtin_cpu_supports("avx2")) {
+		return ISA_AVX2;
+	}
+#endif
+
+	return ISA_SCALAR;
+}
+
+bool isa_find(const char *name, enum isa *isa) {
+	unsigned int i;
+
+	assert(name != NULL);
+	assert(isa != NULL);
+
+	for (i = 0; i < NISAS; i++) {
+		if (strcmp(isa_names[i], name) == 0) {
+			*isa = (enum isa)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void isa_list(void) {
+	unsigned int i;
+
+	for (i = 0; i < NISAS; i++) {
+		printf("%s ", isa_names[i]);
+	}
+	printf("\n");
+}
+
+bool kernel_dispatch(enum isa isa) {
+	if (isa > isa_detect()) {
+		fprintf(stderr, "This CPU does not support %s\n", isa_names[isa]);
+		return false;
+	}
+
+	switch (isa) {
+#if HAVE_X86_ISA
+	case ISA_AVX512:
+		batch_impl = is_perfect_batch_avx512;
+		break;
+	case ISA_AVX2:
+		batch_impl = is_perfect_batch_avx2;
+		break;
+#endif
+	default:
+		batch_impl = is_perfect_batch_scalar;
+		break;
+	}
+
+	return true;
+}
@@ -0,0 +1,526 @@
+/**
+ * @file sigma.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the divisor-sum kernels used by compute to test candidates.
+ *
+ */
+#ifndef SIGMA_H
+#define SIGMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "prefilter.h"
+
+// Also included by the C++ kernels
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Name of the kernel used when none is requested
+#define KERNEL_DEFAULT "sieve"
+
+/// Largest number of candidates a batch kernel tests at once
+#define KERNEL_BATCH 8
+
+/// Sieve kernels are exact below this, where sigma(n) still fits in 64 bits
+#define SIEVE_LIMIT ((uint64_t)1 << 61)
+
+/// Largest number the smallest-prime-factor table can cover
+#define SPF_LIMIT ((uint64_t)UINT32_MAX - 1)
+
+/**
+ * Instruction sets the batch kernel is built for, slowest first
+ */
+enum isa {
+	ISA_SCALAR,	///< No vector instructions
+	ISA_AVX2,	///< 256-bit vectors
+	ISA_AVX512	///< 512-bit vectors
+};
+
+/**
+ * Signature shared by all single-candidate kernels
+ */
+typedef bool (*kernel_fn)(uint64_t n);
+
+/**
+ * Signature shared by all range kernels. Fills sums[i] with sigma(start + i).
+ */
+typedef void (*sieve_fn)(uint64_t *sums, uint64_t start, unsigned int count);
+
+/**
+ * Signature shared by all batch kernels. Tests up to KERNEL_BATCH candidates
+ * and returns a mask with bit i set if n[i] is a perfect number.
+ */
+typedef unsigned int (*batch_fn)(const uint64_t *n, unsigned int count);
+
+/**
+ * Signature of kernel setup functions. Prepares the kernel for candidates up
+ * to limit and returns false if that is not possible.
+ */
+typedef bool (*init_fn)(uint64_t limit);
+
+/**
+ * Counters for how the pair kernel decided each candidate, for how many
+ * candidates the prefilter kept from reaching a kernel, and for how the
+ * candidates that did reach one were classified. Only kernels that finish
+ * sigma(n) can update the highest abundancy seen. Candidates answered from a
+ * table of earlier runs reach neither and are only counted in looked_up.
+ * Mersenne exponent searches only use the trial factoring counters.
+ */
+struct kernel_stats {
+	uint64_t abundant_exits;	///< Stopped once the partial sum passed n
+	uint64_t deficient_exits;	///< Stopped once the rest could not reach n
+	uint64_t full_scans;		///< Scanned every divisor up to sqrt(n)
+	uint64_t skipped;			///< Trial divisions saved by stopping early
+	uint64_t rejected[PREFILTER_STAGES];	///< Candidates each prefilter stage rejected
+	uint64_t abundant;			///< Candidates with sigma(n) > 2n
+	uint64_t deficient;			///< Candidates with sigma(n) < 2n
+	uint64_t perfect;			///< Candidates with sigma(n) = 2n
+	uint64_t peak_n;			///< Candidate with the highest sigma(n) / n, 0 if none
+	uint64_t peak_sigma;		///< sigma(peak_n)
+	uint64_t looked_up;			///< Candidates answered from a table instead
+	uint64_t factored;			///< Mersenne exponents ruled out by trial factoring
+	uint64_t factor_ns;			///< Nanoseconds spent trial factoring
+};
+
+/**
+ * Named kernel table entry
+ */
+struct kernel {
+	const char *name;	///< Name used to select the kernel on the command line
+	kernel_fn test;		///< Tests a single candidate
+	sieve_fn sieve;		///< Computes sigma over a range, NULL if unsupported
+	batch_fn batch;		///< Tests several candidates at once, NULL if unsupported
+	init_fn init;		///< Prepares the kernel for a limit, NULL if not needed
+};
+
+/// Counters updated by is_perfect_number(), cleared by whoever reports them.
+/// Each thread counts its own candidates.
+extern __thread struct kernel_stats kernel_stats;
+
+/**
+ * @brief Counts a candidate whose divisor sum is known
+ *
+ * Preconditions: n is positive
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Candidate
+ * @param sigma Sum of all divisors of n
+ */
+void kernel_classify(uint64_t n, unsigned __int128 sigma);
+
+/**
+ * @brief Keeps whichever of two numbers has the higher abundancy
+ *
+ * Abundancies are compared as sigma(n) * m against sigma(m) * n in 128 bits,
+ * so no precision is lost.
+ *
+ * Preconditions: peak_n is not NULL, peak_sigma is not NULL
+ *
+ * Postconditions: peak_n and peak_sigma hold n and sigma if n's abundancy is
+ * higher or no peak was set yet
+ *
+ * @param peak_n Number with the highest abundancy so far, 0 if none
+ * @param peak_sigma sigma(peak_n)
+ * @param n Number to compare, 0 if none
+ * @param sigma sigma(n)
+ */
+void kernel_peak(uint64_t *peak_n, uint64_t *peak_sigma, uint64_t n, uint64_t sigma);
+
+/**
+ * @brief Adds one set of kernel counters to a running total
+ *
+ * Preconditions: total is not NULL, stats is not NULL
+ *
+ * Postconditions: Each counter in stats has been added to total, and total
+ * holds the higher of the two peaks
+ *
+ * @param total Running total
+ * @param stats Counters to add
+ */
+void kernel_stats_add(struct kernel_stats *total, const struct kernel_stats *stats);
+
+/**
+ * @brief Checks if an integer is a perfect number.
+ *
+ * Sums divisor pairs (i, n / i) for every i up to the square root of n, so the
+ * cost of each candidate is O(sqrt(n)) and no divisors are stored. Candidates
+ * below 2^32 use 32-bit division, and larger ones below 2^52 divide in double
+ * precision, so wide candidates cost little more per trial divisor. The scan
+ * stops as soon as the partial sum passes n, or as soon as the largest sum the
+ * remaining pairs could add cannot bring it up to n. kernel_stats records
+ * which way each candidate was decided.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool is_perfect_number(uint64_t n);
+
+/**
+ * @brief Checks if an integer is a perfect number by testing every i < n.
+ *
+ * This is the original O(n) kernel. It is kept as a reference for validating
+ * and benchmarking the faster kernels.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool is_perfect_number_naive(uint64_t n);
+
+/**
+ * @brief Checks up to KERNEL_BATCH integers for perfect numbers at once
+ *
+ * Every lane shares each trial divisor d. Division is done in double precision
+ * by multiplying with 1 / d and rounding: for candidates below 2^50 the
+ * rounded quotient q is exact whenever d divides n, and q * d == n tells the
+ * two cases apart. Batches with a candidate of 2^50 or more are handed to
+ * is_perfect_batch_scalar(), since their lanes would no longer be exact. The
+ * lanes are written with GCC vector extensions and built once per instruction
+ * set. The first call binds the widest one the CPU has, unless
+ * kernel_dispatch() picked one already. CPUs without AVX2 use
+ * is_perfect_batch_scalar() instead.
+ *
+ * Preconditions: n is not NULL, count is at most KERNEL_BATCH
+ *
+ * Postconditions:
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number
+ */
+unsigned int is_perfect_batch(const uint64_t *n, unsigned int count);
+
+/**
+ * @brief Checks up to KERNEL_BATCH integers for perfect numbers one at a time
+ *
+ * Scalar fallback for is_perfect_batch() built on is_perfect_number().
+ *
+ * Preconditions: n is not NULL, count is at most KERNEL_BATCH
+ *
+ * Postconditions:
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number
+ */
+unsigned int is_perfect_batch_scalar(const uint64_t *n, unsigned int count);
+
+/**
+ * @brief Computes sigma(n) for every n in a segment
+ *
+ * Adds each d up to the square root of the segment end, along with its
+ * cofactor, to every multiple of d in the segment. The cost of a segment is
+ * O(count * log(end) + sqrt(end)) rather than O(count * sqrt(end)), so callers
+ * should keep count near the size of the L2 cache.
+ *
+ * Preconditions: sums is not NULL, start is positive, count is positive,
+ * start + count - 1 is below SIEVE_LIMIT
+ *
+ * Postconditions: sums[i] holds the sum of all divisors of start + i
+ *
+ * @param sums Array of at least count elements to fill
+ * @param start First number in the segment
+ * @param count Number of numbers in the segment
+ */
+void sigma_sieve(uint64_t *sums, uint64_t start, unsigned int count);
+
+/**
+ * @brief Builds the smallest-prime-factor table
+ *
+ * The table is built once per process and reused for every later candidate.
+ * Asking for a limit beyond the current table rebuilds it with at least twice
+ * the room, so ranges handed out one at a time do not rebuild it every time.
+ *
+ * Preconditions:
+ *
+ * Postconditions: The table covers every number up to limit or an error has
+ * been reported
+ *
+ * @param limit Largest number that will be looked up
+ * @return true on success, false if limit is past SPF_LIMIT or the table could
+ * not be allocated
+ */
+bool spf_init(uint64_t limit);
+
+/**
+ * @brief Computes sigma(n) from its factorization in the smallest-prime-factor
+ * table
+ *
+ * Each step divides out the smallest prime factor, so the cost is O(log n).
+ *
+ * Preconditions: n is positive, n is covered by the table
+ *
+ * Postconditions:
+ *
+ * @param n Number to compute sigma of
+ * @return Sum of all divisors of n
+ */
+uint64_t spf_sigma(uint64_t n);
+
+/**
+ * @brief Checks if an integer is a perfect number using the
+ * smallest-prime-factor table
+ *
+ * Falls back to is_perfect_number() for numbers beyond the table.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool spf_is_perfect(uint64_t n);
+
+/**
+ * @brief Computes sigma(n) for every n in a segment using the
+ * smallest-prime-factor table
+ *
+ * Preconditions: sums is not NULL, start is positive, count is positive, the
+ * table covers start + count - 1
+ *
+ * Postconditions: sums[i] holds the sum of all divisors of start + i
+ *
+ * @param sums Array of at least count elements to fill
+ * @param start First number in the segment
+ * @param count Number of numbers in the segment
+ */
+void spf_sieve(uint64_t *sums, uint64_t start, unsigned int count);
+
+/**
+ * @brief Lists the primes up to the square root of a limit
+ *
+ * These are all the primes needed to factor any number up to limit.
+ *
+ * Preconditions: count is not NULL
+ *
+ * Postconditions: count holds the number of primes, or an error has been
+ * reported
+ *
+ * @param limit Largest number the primes must be able to factor
+ * @param count Set to the number of primes listed
+ * @return Array of primes in increasing order to be freed by the caller, NULL
+ * if it could not be allocated
+ */
+uint32_t *prime_build(uint64_t limit, uint64_t *count);
+
+/**
+ * @brief Builds the prime table used by prime_is_perfect()
+ *
+ * Like spf_init(), a limit past the current table rebuilds it with room to
+ * spare. A table attached with prime_attach() that already covers limit is
+ * kept.
+ *
+ * Preconditions:
+ *
+ * Postconditions: The table covers every number up to limit or an error has
+ * been reported
+ *
+ * @param limit Largest number that will be tested
+ * @return true on success, false if the table could not be allocated
+ */
+bool prime_init(uint64_t limit);
+
+/**
+ * @brief Uses a prime table built elsewhere, such as in shared memory
+ *
+ * The table is not copied, so it must outlive every later call to
+ * prime_is_perfect().
+ *
+ * Preconditions: primes is not NULL unless count is 0, primes holds every
+ * prime up to the square root of limit in increasing order
+ *
+ * Postconditions: prime_is_perfect() uses primes
+ *
+ * @param primes Table built by prime_build()
+ * @param count Number of primes in the table
+ * @param limit Limit the table was built for
+ */
+void prime_attach(const uint32_t *primes, uint64_t count, uint64_t limit);
+
+/**
+ * @brief Checks if an integer is a perfect number by factoring it with primes
+ *
+ * Divides n only by the primes in the table, dividing each prime out fully,
+ * and multiplies sigma(p^k) for each prime power found. The scan stops once
+ * the square of the next prime passes what is left of n. There are about
+ * sqrt(n) / ln(sqrt(n)) primes to try rather than sqrt(n) integers. Like
+ * is_perfect_number(), it stops early once the partial sigma shows that n is
+ * abundant. Numbers beyond the table fall back to wheel_is_perfect().
+ *
+ * Preconditions:
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool prime_is_perfect(uint64_t n);
+
+/**
+ * @brief Checks if an integer is a perfect number by trial factoring it
+ *
+ * Divides out 2, 3, 5 and 7, then tries only the divisors coprime to 210
+ * from a fixed table of gaps, 48 of every 210 numbers. Like
+ * prime_is_perfect() it multiplies up sigma from the prime powers found and
+ * stops early once n is known to be abundant, but it needs no table of
+ * primes, so it covers every n.
+ *
+ * Preconditions:
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool wheel_is_perfect(uint64_t n);
+
+/**
+ * @brief Checks if an integer is a perfect number with the C++ kernels
+ *
+ * Factors n with sigma::prime_trial from sigma.hpp, in 32 bits when n allows,
+ * stopping early once n is known to be abundant. Defined in sigma_cxx.cpp.
+ *
+ * Preconditions:
+ *
+ * Postconditions: kernel_stats has been updated
+ *
+ * @param n Number to test
+ * @return true if n is a perfect number, false otherwise
+ */
+bool cxx_is_perfect(uint64_t n);
+
+/**
+ * @brief Computes sigma(n) for each n in a range with the C++ sieve
+ *
+ * sigma::sieve from sigma.hpp, instantiated for 64-bit words and sums.
+ * Defined in sigma_cxx.cpp.
+ *
+ * Preconditions: sums has room for count entries, start is positive, count is
+ * positive, start + count - 1 is below SIEVE_LIMIT
+ *
+ * Postconditions: sums[i] holds sigma(start + i)
+ *
+ * @param sums Array to load the sums into
+ * @param start First number of the range
+ * @param count Number of numbers in the range
+ */
+void cxx_sieve(uint64_t *sums, uint64_t start, unsigned int count);
+
+/**
+ * @brief Looks up a kernel by name
+ *
+ * Preconditions: name is not NULL
+ *
+ * Postconditions:
+ *
+ * @param name Name of the kernel
+ * @return Pointer to the kernel table entry or NULL if no kernel matches
+ */
+const struct kernel *kernel_find(const char *name);
+
+/**
+ * @brief Looks up a kernel by its position in the kernel table
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param i Index into the kernel table
+ * @return Pointer to the kernel table entry or NULL if i is past the end
+ */
+const struct kernel *kernel_at(unsigned int i);
+
+/**
+ * @brief Finds the widest instruction set the CPU supports
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return The widest instruction set there is a batch kernel for
+ */
+enum isa isa_detect(void);
+
+/**
+ * @brief Looks up an instruction set by name
+ *
+ * Preconditions: name is not NULL, isa is not NULL
+ *
+ * Postconditions: isa has been set if the name matched
+ *
+ * @param name Name of the instruction set
+ * @param isa Set to the matching instruction set
+ * @return true if the name matched, false otherwise
+ */
+bool isa_find(const char *name, enum isa *isa);
+
+/**
+ * @brief Prints the names of all instruction sets
+ *
+ * Preconditions:
+ *
+ * Postconditions: Instruction set names have been written to stdout
+ */
+void isa_list(void);
+
+/**
+ * @brief Binds the batch kernel to the build for an instruction set
+ *
+ * Preconditions:
+ *
+ * Postconditions: is_perfect_batch() uses the build for isa, or an error has
+ * been reported
+ *
+ * @param isa Instruction set to use
+ * @return true on success, false if the CPU does not support isa
+ */
+bool kernel_dispatch(enum isa isa);
+
+/**
+ * @brief Prints the names of all available kernels
+ *
+ * Preconditions:
+ *
+ * Postconditions: Kernel names have been written to stdout
+ */
+void kernel_list(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIGMA_H
+
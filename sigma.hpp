@@ -0,0 +1,636 @@
+/**
+ * @file sigma.hpp
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Header-only C++ divisor-sum kernels, specialized at compile time on the
+ * width of the integers they work in and on how they find divisors. The
+ * small-prime and wheel tables they use are generated by the compiler.
+ *
+ */
+#ifndef SIGMA_HPP
+#define SIGMA_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace sigma {
+
+/**
+ * Integer type that holds sigma(n) for every n a Word holds. Nothing is wider
+ * than 128 bits, so 128-bit kernels are only exact while sigma(n) fits, which
+ * it does for every n below 2^124.
+ */
+template <typename Word> struct wider;
+
+template <> struct wider<uint32_t> { using type = uint64_t; };
+template <> struct wider<uint64_t> { using type = unsigned __int128; };
+template <> struct wider<unsigned __int128> { using type = unsigned __int128; };
+
+/// Sum type for a word type
+template <typename Word> using sum_t = typename wider<Word>::type;
+
+/// Primes below this are tried first, from a table built at compile time
+constexpr uint32_t prime_table_limit = 1024;
+
+/// Trial division past the table only visits numbers coprime to this,
+/// 2 * 3 * 5 * 7, skipping 77% of the candidates
+constexpr uint32_t wheel_modulus = 210;
+
+/**
+ * @brief Checks if a small number is prime, for building tables
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to check
+ * @return true if n is prime, false otherwise
+ */
+constexpr bool is_small_prime(uint32_t n) {
+	if (n < 2) {
+		return false;
+	}
+
+	for (uint32_t d = 2; d * d <= n; d++) {
+		if ((n % d) == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Counts the primes below a limit, for sizing tables
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param limit Bound on the primes
+ * @return Number of primes below limit
+ */
+constexpr std::size_t count_small_primes(uint32_t limit) {
+	std::size_t count = 0;
+
+	for (uint32_t n = 2; n < limit; n++) {
+		count += is_small_prime(n);
+	}
+
+	return count;
+}
+
+/**
+ * @brief Builds the table of primes below Limit
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return The primes below Limit in increasing order
+ */
+template <uint32_t Limit>
+constexpr std::array<uint32_t, count_small_primes(Limit)> make_primes() {
+	std::array<uint32_t, count_small_primes(Limit)> primes{};
+	std::size_t i = 0;
+
+	for (uint32_t n = 2; n < Limit; n++) {
+		if (is_small_prime(n) == true) {
+			primes[i++] = n;
+		}
+	}
+
+	return primes;
+}
+
+/// Primes below prime_table_limit
+inline constexpr auto small_primes = make_primes<prime_table_limit>();
+
+/**
+ * @brief Computes a greatest common divisor, for building tables
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param a First number
+ * @param b Second number
+ * @return gcd(a, b)
+ */
+constexpr uint32_t small_gcd(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		uint32_t r = a % b;
+		a = b;
+		b = r;
+	}
+
+	return a;
+}
+
+/**
+ * @brief Counts the residues coprime to a modulus, for sizing tables
+ *
+ * Preconditions: modulus is positive
+ *
+ * Postconditions:
+ *
+ * @param modulus Modulus of the wheel
+ * @return Euler's totient of modulus
+ */
+constexpr std::size_t totient(uint32_t modulus) {
+	std::size_t count = 0;
+
+	for (uint32_t r = 1; r <= modulus; r++) {
+		count += (small_gcd(r, modulus) == 1);
+	}
+
+	return count;
+}
+
+/**
+ * @brief Builds the gaps between successive residues coprime to Modulus
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @return Gaps starting from the residue 1, the last one wrapping around to
+ * Modulus + 1
+ */
+template <uint32_t Modulus>
+constexpr std::array<uint8_t, totient(Modulus)> make_wheel_gaps() {
+	std::array<uint8_t, totient(Modulus)> gaps{};
+	uint32_t last = 1;
+	std::size_t i = 0;
+
+	for (uint32_t r = 2; r <= Modulus + 1; r++) {
+		if (small_gcd(r, Modulus) == 1) {
+			gaps[i++] = r - last;
+			last = r;
+		}
+	}
+
+	return gaps;
+}
+
+/**
+ * Wheel of the residues coprime to Modulus. Starting from a number that is 1
+ * mod Modulus, adding gaps[0], gaps[1], ... in turn visits exactly the
+ * numbers that no prime factor of Modulus divides.
+ */
+template <uint32_t Modulus>
+struct wheel {
+	static constexpr std::size_t spokes = totient(Modulus);
+	static constexpr std::array<uint8_t, spokes> gaps = make_wheel_gaps<Modulus>();
+
+	/**
+	 * @brief Finds the first number the wheel visits at or past a bound
+	 *
+	 * Preconditions: bound is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param bound Smallest number wanted
+	 * @return First number coprime to Modulus that is at least bound
+	 */
+	static constexpr uint32_t first_from(uint32_t bound) {
+		uint32_t d = ((bound - 1) / Modulus) * Modulus + 1;
+
+		for (std::size_t i = 0; d < bound; i++) {
+			d += gaps[i];
+		}
+
+		return d;
+	}
+
+	/**
+	 * @brief Finds the gap to add after first_from(bound)
+	 *
+	 * Preconditions: bound is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param bound Smallest number wanted
+	 * @return Index into gaps of the step from first_from(bound) to the next
+	 * number the wheel visits
+	 */
+	static constexpr std::size_t spoke_from(uint32_t bound) {
+		uint32_t d = ((bound - 1) / Modulus) * Modulus + 1;
+		std::size_t i = 0;
+
+		for (; d < bound; i++) {
+			d += gaps[i];
+		}
+
+		return i % spokes;
+	}
+};
+
+/**
+ * @brief Counts the bits needed to hold n
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to measure
+ * @return Position of the highest set bit plus one, 0 if n is 0
+ */
+inline unsigned int bit_width(uint32_t n) {
+	return (n == 0) ? 0 : 32 - __builtin_clz(n);
+}
+
+inline unsigned int bit_width(uint64_t n) {
+	return (n == 0) ? 0 : 64 - __builtin_clzll(n);
+}
+
+inline unsigned int bit_width(unsigned __int128 n) {
+	uint64_t high = (uint64_t)(n >> 64);
+
+	return (high != 0) ? 64 + bit_width(high) : bit_width((uint64_t)n);
+}
+
+/**
+ * @brief Computes floor(sqrt(n)) in integer arithmetic at any width
+ *
+ * Newton's method from a power of two above the root only ever steps down,
+ * and stops on the floor of the root.
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param n Number to take the root of
+ * @return The largest r with r * r <= n
+ */
+template <typename Word>
+inline Word isqrt(Word n) {
+	Word x;
+	Word y;
+
+	if (n < 2) {
+		return n;
+	}
+
+	x = (Word)1 << ((bit_width(n) + 1) / 2);
+	y = (x + n / x) / 2;
+	while (y < x) {
+		x = y;
+		y = (x + n / x) / 2;
+	}
+
+	return x;
+}
+
+/**
+ * @brief Turns a divisor sum into a comparison with 2n
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param sum sigma(n), or any bound above 2n once n is known to be abundant
+ * @param n Number the sum belongs to
+ * @return Negative if n is deficient, 0 if perfect, positive if abundant
+ */
+template <typename Word>
+inline int order(sum_t<Word> sum, Word n) {
+	sum_t<Word> target = 2 * (sum_t<Word>)n;
+
+	return (sum > target) - (sum < target);
+}
+
+/**
+ * Divisor sums from the pairs d, n / d with d up to the root of n, like the C
+ * pair kernel. compare() stops as soon as the proper divisors pass n.
+ */
+template <typename Word>
+struct pair_scan {
+	using sum_type = sum_t<Word>;
+
+	/**
+	 * @brief Computes sigma(n)
+	 *
+	 * Preconditions: n is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to sum the divisors of
+	 * @return Sum of all divisors of n
+	 */
+	static sum_type sigma(Word n) {
+		Word root = isqrt(n);
+		sum_type sum = 0;
+		Word q;
+
+		for (Word d = 1; d <= root; d++) {
+			if ((n % d) == 0) {
+				q = n / d;
+				sum += d;
+				if (q != d) {
+					sum += q;
+				}
+			}
+		}
+
+		return sum;
+	}
+
+	/**
+	 * @brief Compares sigma(n) with 2n
+	 *
+	 * Preconditions: n is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to classify
+	 * @return Negative if n is deficient, 0 if perfect, positive if abundant
+	 */
+	static int compare(Word n) {
+		Word root = isqrt(n);
+		Word rest = n - 1; // 1 divides everything
+		Word add;
+		Word q;
+
+		if (n < 2) {
+			return -1;
+		}
+
+		for (Word d = 2; d <= root; d++) {
+			if ((n % d) == 0) {
+				// Don't count the square root of a perfect square twice
+				q = n / d;
+				add = (q != d) ? (d + q) : d;
+				if (add > rest) {
+					return 1;
+				}
+				rest -= add;
+			}
+		}
+
+		return (rest == 0) ? 0 : -1;
+	}
+};
+
+/**
+ * Divisor sums from the prime factorization, found by trial division with
+ * the compile-time prime table and then a wheel, like the C prime kernel but
+ * needing no table built at run time.
+ */
+template <typename Word>
+struct prime_trial {
+	using sum_type = sum_t<Word>;
+
+	/**
+	 * @brief Computes sigma(n)
+	 *
+	 * Preconditions: n is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to sum the divisors of
+	 * @return Sum of all divisors of n
+	 */
+	static sum_type sigma(Word n) {
+		return factor<false>(n);
+	}
+
+	/**
+	 * @brief Compares sigma(n) with 2n
+	 *
+	 * Stops as soon as the primes found so far show n is abundant.
+	 *
+	 * Preconditions: n is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to classify
+	 * @return Negative if n is deficient, 0 if perfect, positive if abundant
+	 */
+	static int compare(Word n) {
+		return order<Word>(factor<true>(n), n);
+	}
+
+private:
+	/**
+	 * @brief Divides every factor p out of m and multiplies sigma(p^k) into sum
+	 *
+	 * Preconditions: p divides m
+	 *
+	 * Postconditions: p no longer divides m
+	 *
+	 * @param m Part of n not factored yet
+	 * @param p Prime factor of m
+	 * @param sum Divisor sum of the part of n factored so far
+	 * @param target 2n
+	 * @return true if Exit is set and n is now known to be abundant
+	 */
+	template <bool Exit>
+	static bool divide_out(Word &m, Word p, sum_type &sum, sum_type target) {
+		sum_type term = 1;
+		sum_type power = 1;
+
+		// sigma(p^k) = 1 + p + ... + p^k
+		do {
+			m /= p;
+			power *= p;
+			term += power;
+		} while ((m % p) == 0);
+
+		sum *= term;
+
+		// Whatever is left of m adds a factor of at least m + 1
+		return (Exit == true) && (sum * ((m > 1) ? (sum_type)m + 1 : 1) > target);
+	}
+
+	/**
+	 * @brief Factors n and multiplies up its divisor sum
+	 *
+	 * Preconditions: n is positive
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to factor
+	 * @return sigma(n), or 2n + 1 if Exit is set and n was found abundant
+	 */
+	template <bool Exit>
+	static sum_type factor(Word n) {
+		using spin = wheel<wheel_modulus>;
+		const sum_type target = 2 * (sum_type)n;
+		sum_type sum = 1;
+		Word m = n;
+		constexpr uint32_t first = spin::first_from(prime_table_limit);
+		constexpr std::size_t spoke = spin::spoke_from(prime_table_limit);
+		Word d;
+		std::size_t i;
+
+		for (uint32_t p : small_primes) {
+			if ((Word)p > m / p) {
+				return (m > 1) ? sum * ((sum_type)m + 1) : sum;
+			}
+
+			if (((m % p) == 0) && (divide_out<Exit>(m, p, sum, target) == true)) {
+				return target + 1;
+			}
+		}
+
+		// Pick the wheel up at the first spoke past the table, so that no
+		// divisor the table already tried is tried again
+		d = first;
+		for (i = spoke; d <= m / d; i = (i + 1) % spin::spokes) {
+			if (((m % d) == 0) && (divide_out<Exit>(m, d, sum, target) == true)) {
+				return target + 1;
+			}
+			d += spin::gaps[i];
+		}
+
+		// No number up to the root of m divides it, so m is 1 or prime
+		return (m > 1) ? sum * ((sum_type)m + 1) : sum;
+	}
+};
+
+/**
+ * Divisor sums for a whole range at once, adding each divisor d up to the
+ * root of the range to its multiples along with the cofactor, like the C
+ * sieve kernel.
+ */
+template <typename Word>
+struct sieve {
+	using sum_type = sum_t<Word>;
+
+	/**
+	 * @brief Computes sigma(n) for each n in a range
+	 *
+	 * Preconditions: out has room for count entries, start is positive,
+	 * count is positive, start + count - 1 is below half the largest Word and
+	 * its sigma fits in a Sum
+	 *
+	 * Postconditions: out[i] holds sigma(start + i)
+	 *
+	 * @param out Array to load the sums into
+	 * @param start First number of the range
+	 * @param count Number of numbers in the range
+	 */
+	template <typename Sum>
+	static void sums(Sum *out, Word start, unsigned int count) {
+		Word end = start + count - 1;
+		Word square;
+		Word m;
+		Word q;
+
+		for (unsigned int i = 0; i < count; i++) {
+			out[i] = 0;
+		}
+
+		for (Word d = 1; d <= end / d; d++) {
+			// Smaller divisors of m were counted with their cofactors, so
+			// only visit multiples at or above d * d
+			square = d * d;
+			m = ((start + d - 1) / d) * d;
+			if (m <= square) {
+				m = square;
+				out[m - start] += d;
+				m += d;
+			}
+
+			for (q = m / d; m <= end; m += d, q++) {
+				out[m - start] += (Sum)d + q;
+			}
+		}
+	}
+
+	/**
+	 * @brief Computes sigma(n) as a range of one
+	 *
+	 * Preconditions: n is positive and below half the largest Word
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to sum the divisors of
+	 * @return Sum of all divisors of n
+	 */
+	static sum_type sigma(Word n) {
+		sum_type sum;
+
+		sums(&sum, n, 1);
+		return sum;
+	}
+
+	/**
+	 * @brief Compares sigma(n) with 2n
+	 *
+	 * Preconditions: n is positive and below half the largest Word
+	 *
+	 * Postconditions:
+	 *
+	 * @param n Number to classify
+	 * @return Negative if n is deficient, 0 if perfect, positive if abundant
+	 */
+	static int compare(Word n) {
+		return order<Word>(sigma(n), n);
+	}
+};
+
+/**
+ * @brief Compares sigma(n) with 2n using the narrowest word with room for n
+ *
+ * Numbers below 2^31 run in 32 bits, where division is several times
+ * cheaper, and leave the sieve room to step past n.
+ *
+ * Preconditions: n is positive
+ *
+ * Postconditions:
+ *
+ * @param n Number to classify
+ * @return Negative if n is deficient, 0 if perfect, positive if abundant
+ */
+template <template <typename> class Strategy>
+inline int compare(uint64_t n) {
+	if (n < ((uint64_t)1 << 31)) {
+		return Strategy<uint32_t>::compare((uint32_t)n);
+	}
+
+	return Strategy<uint64_t>::compare(n);
+}
+
+/**
+ * @brief Checks if n is perfect using the narrowest word with room for n
+ *
+ * Preconditions: n is positive
+ *
+ * Postconditions:
+ *
+ * @param n Number to check
+ * @return true if n is perfect, false otherwise
+ */
+template <template <typename> class Strategy>
+inline bool is_perfect(uint64_t n) {
+	return compare<Strategy>(n) == 0;
+}
+
+} // namespace sigma
+
+#endif // SIGMA_HPP
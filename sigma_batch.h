@@ -0,0 +1,131 @@
+/**
+ * @file sigma_batch.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Body of the vector batch kernel, included by sigma.c once per instruction
+ * set. Before each inclusion, BATCH_NAME names the function, BATCH_TARGET is
+ * the GCC target it is built for, and BATCH_BYTES is the width in bytes of
+ * that target's vector registers. There is no include guard on purpose.
+ *
+ */
+
+/**
+ * @brief Checks up to KERNEL_BATCH integers for perfect numbers at once
+ *
+ * See is_perfect_batch() for how the lanes divide.
+ *
+ * Preconditions: n is not NULL, count is at most KERNEL_BATCH, the CPU
+ * supports BATCH_TARGET
+ *
+ * Postconditions:
+ *
+ * @param n Candidates to test
+ * @param count Number of candidates
+ * @return Mask with bit i set if n[i] is a perfect number
+ */
+static unsigned int BATCH_NAME(const uint64_t *n, unsigned int count)
+		__attribute__((target(BATCH_TARGET)));
+
+static unsigned int BATCH_NAME(const uint64_t *n, unsigned int count) {
+	// One candidate per lane. Vectors wider than the target are split into
+	// scalars by GCC, so BATCH_BYTES must match the hardware.
+	typedef double batch_double __attribute__((vector_size(BATCH_BYTES)));
+
+	// The result of comparing batch_doubles, all ones or all zeros per lane
+	typedef int64_t batch_mask __attribute__((vector_size(BATCH_BYTES)));
+
+	enum {
+		LANES = BATCH_BYTES / sizeof(double),
+		NVECTORS = KERNEL_BATCH / LANES
+	};
+
+	batch_double value[NVECTORS] = { { 0 } };
+	batch_double sum[NVECTORS];
+	batch_double quotient;
+	batch_double divisor;
+	batch_double inverse;
+	batch_double zero = { 0 };
+	batch_mask found;
+	uint64_t largest = 0;
+	uint64_t d;
+	unsigned int mask = 0;
+	unsigned int i;
+	unsigned int v;
+
+	assert(n != NULL);
+	assert(count <= KERNEL_BATCH);
+
+	for (i = 0; i < count; i++) {
+		if (n[i] >= BATCH_EXACT_LIMIT) {
+			return is_perfect_batch_scalar(n, count);
+		}
+	}
+
+	// Unused lanes stay 0, which no divisor passes
+	for (i = 0; i < count; i++) {
+		value[i / LANES][i % LANES] = n[i];
+		if (n[i] > largest) {
+			largest = n[i];
+		}
+	}
+
+	// 1 divides everything, but 1 itself has no proper divisors
+	for (v = 0; v < NVECTORS; v++) {
+		sum[v] = (batch_double)((batch_mask)(value[v] > 1) & (batch_mask)(zero + 1));
+	}
+
+	for (d = 2; d * d <= largest; d++) {
+		divisor = zero + (double)d;
+		inverse = zero + 1.0 / d;
+
+		for (v = 0; v < NVECTORS; v++) {
+			quotient = (value[v] * inverse + ROUND_MAGIC) - ROUND_MAGIC;
+
+			// d divides the lane and is not past the lane's square root
+			found = (quotient * divisor == value[v]) & (divisor <= quotient);
+
+			// Count the square root of a perfect square once
+			sum[v] += (batch_double)(found & (batch_mask)(divisor +
+					(batch_double)((batch_mask)quotient & (divisor != quotient))));
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if ((sum[i / LANES][i % LANES] == n[i]) && (n[i] > 1)) {
+			mask |= 1U << i;
+		}
+
+		// Every lane's sum is exact here, so it is free to classify
+		if (n[i] > 0) {
+			kernel_classify(n[i], (uint64_t)sum[i / LANES][i % LANES] + n[i]);
+		}
+	}
+
+	return mask;
+}
+
+#undef BATCH_NAME
+#undef BATCH_TARGET
+#undef BATCH_BYTES
@@ -0,0 +1,63 @@
+/**
+ * @file sigma_cxx.cpp
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Exposes the C++ kernels in sigma.hpp to the C programs as the "cxx"
+ * kernel.
+ *
+ */
+#include <cassert>
+#include "sigma.h"
+#include "sigma.hpp"
+
+bool cxx_is_perfect(uint64_t n) {
+	int order;
+
+	if (n < 2) {
+		// 1 has no proper divisors
+		return false;
+	}
+
+	order = sigma::compare<sigma::prime_trial>(n);
+
+	if (order > 0) {
+		kernel_stats.abundant++;
+	} else if (order < 0) {
+		kernel_stats.deficient++;
+	} else {
+		kernel_stats.perfect++;
+	}
+
+	return (order == 0);
+}
+
+void cxx_sieve(uint64_t *sums, uint64_t start, unsigned int count) {
+	assert(sums != NULL);
+	assert(start > 0);
+	assert(count > 0);
+	assert(start + count - 1 < SIEVE_LIMIT);
+
+	sigma::sieve<uint64_t>::sums(sums, start, count);
+}
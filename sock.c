@@ -28,6 +28,7 @@
  *
  */
 #include <arpa/inet.h>
+#include <netinet/tcp.h> // For TCP_NODELAY
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -55,6 +56,18 @@ int sock_connect(char *host) {
 		return -1;
 	}
 
+	sock_nodelay(fd);
+
 	return fd;
 }
 
+void sock_nodelay(int fd) {
+	int on = 1;
+
+	// Packets are small and always answered, so Nagle's algorithm only
+	// stalls a back to back stats/done pair until the peer's delayed ACK
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) == -1) {
+		perror("Unable to disable Nagle's algorithm");
+	}
+}
+
@@ -45,5 +45,17 @@
  */
 int sock_connect(char *host);
 
+/**
+ * @brief Send packets as soon as they are written
+ *
+ * Preconditions: fd is a connected TCP socket
+ *
+ * Postconditions: Nagle's algorithm is disabled on fd, or an error has been
+ * reported
+ *
+ * @param fd Socket to configure
+ */
+void sock_nodelay(int fd);
+
 #endif // SOCK_H
 
@@ -0,0 +1,270 @@
+/**
+ * @file table.c
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Defines the persistent table of tested and perfect numbers that compute
+ * processes share across runs.
+ *
+ */
+#include <sys/file.h> // For flock
+#include <sys/mman.h>
+#include <sys/stat.h> // For S_IRUSR, etc.
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "table.h"
+
+/**
+ * @brief Computes the mask of the bits for first to last within one word
+ *
+ * Preconditions: first and last are in the same word, first <= last
+ *
+ * Postconditions:
+ *
+ * @param first First number
+ * @param last Last number
+ * @return Mask with the bits for first through last set
+ */
+static uint64_t word_mask(uint64_t first, uint64_t last);
+
+/**
+ * @brief Sets resource locations in res for a mapped table file
+ *
+ * Preconditions: res is not NULL, addr points to a mapping of
+ * table_size(limit) bytes
+ *
+ * Postconditions: Resource locations have been set in res
+ *
+ * @param res Pointer to table resource structure
+ * @param addr Address the table file is mapped at
+ * @param limit Largest number the table covers
+ */
+static void table_map(struct table_res *res, void *addr, uint64_t limit);
+
+size_t table_size(uint64_t limit) {
+	return sizeof(struct table_header) + (2 * ((limit / 64) + 1) * sizeof(uint64_t));
+}
+
+bool table_attach(struct table_res *res, const char *path, uint64_t limit) {
+	struct table_header header;
+	struct stat st;
+	int fd;
+	void *addr;
+
+	assert(res != NULL);
+	assert(path != NULL);
+	assert(limit > 0);
+
+	res->addr = NULL;
+
+	fd = open(path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd == -1) {
+		perror("Could not open table");
+		return false;
+	}
+
+	// Hold the lock until the header is known good so no process maps a
+	// file that is still being created
+	if (flock(fd, LOCK_EX) == -1) {
+		perror("Could not lock table");
+		close(fd);
+		return false;
+	}
+
+	if (fstat(fd, &st) == -1) {
+		perror("Could not stat table");
+		close(fd);
+		return false;
+	}
+
+	if (st.st_size == 0) {
+		// New file, which reads as zeros: nothing tested yet
+		if (ftruncate(fd, table_size(limit)) == -1) {
+			perror("Could not resize table");
+			close(fd);
+			return false;
+		}
+	} else {
+		if ((pread(fd, &header, sizeof(header), 0) != sizeof(header)) ||
+				(header.magic != TABLE_MAGIC)) {
+			fprintf(stderr, "%s is not a table file\n", path);
+			close(fd);
+			return false;
+		}
+
+		if (header.version != TABLE_VERSION) {
+			fprintf(stderr, "%s has version %u, expected %u\n", path, header.version,
+					TABLE_VERSION);
+			close(fd);
+			return false;
+		}
+
+		if ((header.limit == 0) || ((uint64_t)st.st_size != table_size(header.limit))) {
+			fprintf(stderr, "%s is truncated\n", path);
+			close(fd);
+			return false;
+		}
+
+		limit = header.limit;
+	}
+
+	addr = mmap(NULL, table_size(limit), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		perror("Could not map table");
+		close(fd);
+		return false;
+	}
+
+	table_map(res, addr, limit);
+	if (st.st_size == 0) {
+		res->header->version = TABLE_VERSION;
+		res->header->reserved = 0;
+		res->header->limit = limit;
+		res->header->words = (limit / 64) + 1;
+		__atomic_store_n(&res->header->magic, TABLE_MAGIC, __ATOMIC_RELEASE);
+	}
+
+	// Closing the file also drops the lock
+	close(fd);
+
+	return true;
+}
+
+void table_detach(struct table_res *res) {
+	assert(res != NULL);
+
+	munmap(res->addr, (char *)res->end - (char *)res->addr);
+	res->addr = NULL;
+}
+
+bool table_covers(struct table_res *res, uint64_t start, uint64_t end) {
+	uint64_t mask;
+	uint64_t first;
+	uint64_t last;
+	uint64_t word;
+
+	assert(res != NULL);
+	assert(start > 0);
+	assert(end >= start);
+
+	if (end > res->header->limit) {
+		return false;
+	}
+
+	for (first = start; first <= end; first = last + 1) {
+		last = first | 63;
+		if (last > end) {
+			last = end;
+		}
+
+		mask = word_mask(first, last);
+		word = __atomic_load_n(&res->tested[first / 64], __ATOMIC_ACQUIRE);
+		if ((word & mask) != mask) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint64_t table_next_perfect(struct table_res *res, uint64_t n, uint64_t end) {
+	uint64_t word;
+	uint64_t last;
+
+	assert(res != NULL);
+	assert(end <= res->header->limit);
+
+	for (; n <= end; n = last + 1) {
+		last = n | 63;
+		if (last > end) {
+			last = end;
+		}
+
+		word = res->perfect[n / 64] & word_mask(n, last);
+		if (word != 0) {
+			return (n & ~(uint64_t)63) + __builtin_ctzll(word);
+		}
+	}
+
+	return 0;
+}
+
+void table_record(struct table_res *res, uint64_t n) {
+	assert(res != NULL);
+
+	if (n <= res->header->limit) {
+		// Ordered by the release in table_mark()
+		__atomic_fetch_or(&res->perfect[n / 64], (uint64_t)1 << (n % 64),
+				__ATOMIC_RELAXED);
+	}
+}
+
+void table_mark(struct table_res *res, uint64_t start, uint64_t end) {
+	uint64_t mask;
+	uint64_t first;
+	uint64_t last;
+
+	assert(res != NULL);
+	assert(start > 0);
+	assert(end >= start);
+
+	if (end > res->header->limit) {
+		end = res->header->limit;
+	}
+
+	for (first = start; first <= end; first = last + 1) {
+		last = first | 63;
+		if (last > end) {
+			last = end;
+		}
+
+		mask = word_mask(first, last);
+		if (mask == UINT64_MAX) {
+			// Whole word, nobody can set a bit we would lose
+			__atomic_store_n(&res->tested[first / 64], mask, __ATOMIC_RELEASE);
+		} else {
+			__atomic_fetch_or(&res->tested[first / 64], mask, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+static uint64_t word_mask(uint64_t first, uint64_t last) {
+	assert(first / 64 == last / 64);
+	assert(first <= last);
+
+	return (UINT64_MAX >> (63 - (last % 64))) & (UINT64_MAX << (first % 64));
+}
+
+static void table_map(struct table_res *res, void *addr, uint64_t limit) {
+	assert(res != NULL);
+	assert(addr != NULL);
+
+	res->addr = addr;
+	res->header = res->addr;
+	res->tested = (uint64_t *)(res->header + 1);
+	res->perfect = res->tested + (limit / 64) + 1;
+	res->end = res->perfect + (limit / 64) + 1;
+}
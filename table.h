@@ -0,0 +1,174 @@
+/**
+ * @file table.h
+ * @author Dan Albert
+ * @date Created 10/16/2026
+ * @date Last updated 10/16/2026
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * @section DESCRIPTION
+ *
+ * Declares the persistent table of tested and perfect numbers that compute
+ * processes share across runs.
+ *
+ */
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Identifies a table file, "PERFTBL" in the low bytes
+#define TABLE_MAGIC 0x004c425446524550ULL
+
+/// Bumped whenever the layout of the file changes
+#define TABLE_VERSION 1
+
+/// Largest number a new table covers. The file is sparse, so only the parts
+/// of the 1 GiB of bitmaps that have been written take up disk space.
+#define TABLE_LIMIT_DEFAULT ((uint64_t)1 << 32)
+
+/**
+ * Header at the start of a table file. magic is written last when the file is
+ * created, so a file with a bad magic was never finished.
+ */
+struct table_header {
+	uint64_t magic;		///< TABLE_MAGIC
+	uint32_t version;	///< TABLE_VERSION
+	uint32_t reserved;	///< Zero
+	uint64_t limit;		///< Largest number the bitmaps cover
+	uint64_t words;		///< Length of each bitmap in 64 bit words
+};
+
+/**
+ * Table layout structure. Bit n of each bitmap stands for the number n.
+ */
+struct table_res {
+	void *addr;
+	struct table_header *header;
+	uint64_t *tested;	///< Set once n has been tested
+	uint64_t *perfect;	///< Set if n is perfect, only meaningful once tested
+	void *end;
+};
+
+/**
+ * @brief Computes the size of a table file
+ *
+ * Preconditions:
+ *
+ * Postconditions:
+ *
+ * @param limit Largest number the table covers
+ * @return Size of the table file in bytes
+ */
+size_t table_size(uint64_t limit);
+
+/**
+ * @brief Opens and mmaps a table file, creating it if needed
+ *
+ * The file is locked while it is checked or created, so processes starting
+ * together agree on its layout. A file with the wrong magic, version or size
+ * is refused rather than overwritten.
+ *
+ * Preconditions: res is not NULL, path is not NULL, limit is positive
+ *
+ * Postconditions: The table has been mapped and resource locations have been
+ * set in res, or an error has been reported and res->addr is NULL
+ *
+ * @param res Pointer to table resource structure
+ * @param path File to open
+ * @param limit Largest number to cover if the file is created
+ * @return true on success, false otherwise
+ */
+bool table_attach(struct table_res *res, const char *path, uint64_t limit);
+
+/**
+ * @brief Unmaps the table
+ *
+ * Preconditions: res has been attached
+ *
+ * Postconditions: The table is no longer mapped, the file itself remains
+ *
+ * @param res Pointer to table resource structure
+ */
+void table_detach(struct table_res *res);
+
+/**
+ * @brief Checks whether every number in a range has been tested
+ *
+ * Preconditions: res has been attached, start is positive, end is not less
+ * than start
+ *
+ * Postconditions:
+ *
+ * @param res Pointer to table resource structure
+ * @param start First number of the range
+ * @param end Last number of the range
+ * @return true if the range is within the table and all of it was tested
+ */
+bool table_covers(struct table_res *res, uint64_t start, uint64_t end);
+
+/**
+ * @brief Finds the next perfect number recorded in a range
+ *
+ * Preconditions: res has been attached, table_covers(res, n, end) is true
+ *
+ * Postconditions:
+ *
+ * @param res Pointer to table resource structure
+ * @param n First number to look at
+ * @param end Last number to look at
+ * @return The smallest perfect number from n to end, 0 if there is none
+ */
+uint64_t table_next_perfect(struct table_res *res, uint64_t n, uint64_t end);
+
+/**
+ * @brief Records a perfect number
+ *
+ * Only becomes visible to lookups once table_mark() covers n.
+ *
+ * Preconditions: res has been attached
+ *
+ * Postconditions: n is recorded as perfect if it is within the table
+ *
+ * @param res Pointer to table resource structure
+ * @param n Perfect number found
+ */
+void table_record(struct table_res *res, uint64_t n);
+
+/**
+ * @brief Marks every number in a range as tested
+ *
+ * Words shared with other ranges are updated with an atomic OR, and all of
+ * them with release ordering, so a process that sees a number as tested also
+ * sees whether table_record() marked it perfect.
+ *
+ * Preconditions: res has been attached, start is positive, end is not less
+ * than start, every perfect number in the range has been recorded
+ *
+ * Postconditions: The part of the range within the table is marked tested
+ *
+ * @param res Pointer to table resource structure
+ * @param start First number of the range
+ * @param end Last number of the range
+ */
+void table_mark(struct table_res *res, uint64_t start, uint64_t end);
+
+#endif // TABLE_H
@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# Checks that manage respawns a compute for a one-number remainder and that
+# the new compute tests it. Manage is given a single compute for 1..6, which
+# stops with only 6 untested, so 6 is only found if the respawned compute
+# accepts a range that starts and ends on the same number.
+#
+# Run from the top directory after building, or with make check.
+
+top=$(pwd)
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cp "$top/tests/stopped-compute.sh" "$dir/compute"
+chmod +x "$dir/compute"
+cd "$dir" || exit 1
+
+REAL_COMPUTE="$top/compute" "$top/manage" p 6 1 &
+manage=$!
+
+# Manage makes its FIFO once the computes are spawned
+tries=0
+while [ ! -p .perfect_numbers ]; do
+	tries=$((tries + 1))
+	if [ $tries -gt 50 ]; then
+		echo "respawn: manage did not start"
+		kill $manage
+		exit 1
+	fi
+	sleep 0.1
+done
+
+output=$(timeout 30 "$top/report" p)
+status=$?
+if [ $status -ne 0 ]; then
+	# Manage is still waiting for a compute that never finished
+	kill $manage 2> /dev/null
+fi
+wait $manage
+
+if [ $status -ne 0 ] || ! echo "$output" | grep -qx 6 ||
+		! echo "$output" | grep -q "Computation complete"; then
+	echo "respawn: FAILED"
+	echo "$output"
+	exit 1
+fi
+
+echo "respawn: passed"
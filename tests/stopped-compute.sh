@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# Stands in for compute in tests/respawn.sh. The first time it is spawned it
+# acts like a compute signaled just before the last number of its range:
+# it returns that one number in a remainder packet and closes. Every later
+# spawn runs the real compute, named by REAL_COMPUTE.
+#
+# Packets are written as compute lays out union packet on x86-64: 136 bytes,
+# the packet id and pid as 32-bit integers, then the payload.
+
+# Size of union packet
+PACKET_SIZE=136
+
+# Packet identifiers, from enum packet_id
+PACKETID_CLOSED=2
+PACKETID_REMAINDER=13
+
+# Writes $1 as a little-endian integer of $2 bytes
+put() {
+	value=$1
+	bytes=$2
+	while [ "$bytes" -gt 0 ]; do
+		printf "\\$(printf %03o $((value & 255)))"
+		value=$((value >> 8))
+		bytes=$((bytes - 1))
+	done
+}
+
+# Pads a packet of $1 bytes out to PACKET_SIZE
+pad() {
+	head -c $((PACKET_SIZE - $1)) /dev/zero
+}
+
+if [ -e stopped ]; then
+	exec "$REAL_COMPUTE" "$@"
+fi
+touch stopped
+
+# The range end is the last argument
+for end; do :; done
+
+put $PACKETID_REMAINDER 4
+put $$ 4
+put "$end" 8
+put "$end" 8
+pad 24
+
+put $PACKETID_CLOSED 4
+put $$ 4
+pad 8